@@ -1,31 +1,128 @@
+#include "FloodFill.h"
 #include <iostream>
+#include <fstream>
 #include <queue>
+#include <algorithm>
 using namespace std;
 
+namespace flood_fill
+{
+
 // Directions for 8-connected neighbors (up, down, left, right, and diagonals)
 const int DX[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
 const int DY[8] = {0, 0, -1, 1, -1, 1, -1, 1};
 
-// Dimensions of the grid
-const int ROWS = 5;
-const int COLUMNS = 5;
+// Constants for the parallel fill
+const int PARALLEL_CHUNK_SIZE = 1024; // Frontier cells a thread claims at a time
+const int BOTTOM_UP_ALPHA = 14;       // Go bottom-up when the frontier is more than 1/ALPHA of the cells not yet visited...
+const int BOTTOM_UP_BETA = 24;        // ...and more than 1/BETA of the whole grid (a bottom-up pass scans every cell)
+
+// Function to start a trace for a fill of the given grid
+void init_trace(step_trace_data &trace, int grid[ROWS][COLUMNS], int replacement)
+{
+    trace.rows = ROWS;
+    trace.columns = COLUMNS;
+    trace.replacement = replacement;
+    trace.initial.assign(&grid[0][0], &grid[0][0] + ROWS * COLUMNS);
+    trace.steps.resize(ROWS * COLUMNS); // A fill changes each cell at most once, so recording never allocates
+    trace.count = 0;
+}
 
-// Function to print the current state of the grid
-void print_grid(int grid[ROWS][COLUMNS])
+// Function to record one cell change
+inline void record_step(step_trace_data &trace, int x, int y)
 {
-    for (int i = 0; i < ROWS; i++)
+    if (trace.count < trace.steps.size())
     {
-        for (int j = 0; j < COLUMNS; j++)
+        trace_step_data &step = trace.steps[trace.count];
+        step.x = static_cast<uint16_t>(x);
+        step.y = static_cast<uint16_t>(y);
+        step.step = trace.count;
+        trace.count++;
+    }
+}
+
+// Function to write a trace to a binary file
+bool write_trace(const step_trace_data &trace, const string &file_name)
+{
+    ofstream trace_file(file_name, ios::binary);
+    if (!trace_file)
+    {
+        cout << "Could not write trace file " << file_name << "\n";
+        return false;
+    }
+
+    int32_t header[4] = {trace.rows, trace.columns, trace.replacement, static_cast<int32_t>(trace.count)};
+    trace_file.write(reinterpret_cast<const char *>(&TRACE_MAGIC), sizeof(TRACE_MAGIC));
+    trace_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    trace_file.write(reinterpret_cast<const char *>(trace.initial.data()), trace.initial.size() * sizeof(int));
+    trace_file.write(reinterpret_cast<const char *>(trace.steps.data()), trace.count * sizeof(trace_step_data));
+    return static_cast<bool>(trace_file);
+}
+
+// Function to read a trace written by write_trace (rejects files whose sizes or steps do not fit their grid)
+bool read_trace(step_trace_data &trace, const string &file_name)
+{
+    ifstream trace_file(file_name, ios::binary);
+    uint32_t magic = 0;
+    int32_t header[4];
+    trace_file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    trace_file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!trace_file || magic != TRACE_MAGIC ||
+        header[0] <= 0 || header[0] > TRACE_MAX_SIDE || header[1] <= 0 || header[1] > TRACE_MAX_SIDE)
+    {
+        cout << "Not a valid trace file: " << file_name << "\n";
+        return false;
+    }
+
+    // Work out the cell count in 64 bits, so a bad header cannot overflow it
+    int64_t cells = static_cast<int64_t>(header[0]) * header[1];
+    if (cells > TRACE_MAX_CELLS || header[3] < 0 || header[3] > cells)
+    {
+        cout << "Not a valid trace file: " << file_name << "\n";
+        return false;
+    }
+
+    trace.rows = header[0];
+    trace.columns = header[1];
+    trace.replacement = header[2];
+    trace.count = header[3];
+    trace.initial.resize(trace.rows * trace.columns);
+    trace.steps.resize(trace.count);
+    trace_file.read(reinterpret_cast<char *>(trace.initial.data()), trace.initial.size() * sizeof(int));
+    trace_file.read(reinterpret_cast<char *>(trace.steps.data()), trace.count * sizeof(trace_step_data));
+    if (!trace_file)
+    {
+        cout << "Trace file is cut short: " << file_name << "\n";
+        return false;
+    }
+
+    // Every step must name a cell of the grid and be numbered in order
+    for (uint32_t i = 0; i < trace.count; i++)
+    {
+        const trace_step_data &step = trace.steps[i];
+        if (step.x >= trace.rows || step.y >= trace.columns || step.step != i)
         {
-            cout << grid[i][j] << " ";
+            cout << "Trace file has a bad step " << i << ": " << file_name << "\n";
+            return false;
         }
-        cout << endl;
     }
-    cout << endl;
+    return true;
 }
 
+// Record a cell change when a trace was passed in (benchmark builds can compile this out to time the bare fill)
+#ifdef FLOODFILL_NO_TRACE
+#define RECORD_STEP(trace, x, y)
+#else
+#define RECORD_STEP(trace, x, y)            \
+    do                                      \
+    {                                       \
+        if (trace != nullptr)               \
+            record_step(*trace, x, y);      \
+    } while (0)
+#endif
+
 // Recursive implementation of Flood Fill using Depth-First Search (DFS)
-void flood_fill_dfs(int grid[ROWS][COLUMNS], int x, int y, int target, int replacement)
+void flood_fill_dfs(int grid[ROWS][COLUMNS], int x, int y, int target, int replacement, step_trace_data *trace)
 {
     // Base case: Check if the current cell is out of bounds or not the target value
     if (x < 0 || x >= ROWS || y < 0 || y >= COLUMNS || grid[x][y] != target)
@@ -33,7 +130,7 @@ void flood_fill_dfs(int grid[ROWS][COLUMNS], int x, int y, int target, int repla
 
     // Replace the current cell with the replacement value
     grid[x][y] = replacement;
-    print_grid(grid);
+    RECORD_STEP(trace, x, y);
 
     // Recursively call flood fill for all 8-connected neighbors
     for (int i = 0; i < 8; i++)
@@ -41,12 +138,12 @@ void flood_fill_dfs(int grid[ROWS][COLUMNS], int x, int y, int target, int repla
         int nx = x + DX[i]; // Calculate the new x-coordinate
         int ny = y + DY[i]; // Calculate the new y-coordinate
 
-        flood_fill_dfs(grid, nx, ny, target, replacement);
+        flood_fill_dfs(grid, nx, ny, target, replacement, trace);
     }
 }
 
 // Iterative implementation of Flood Fill using Breadth-First Search (BFS)
-void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int target, int replacement)
+void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int target, int replacement, step_trace_data *trace)
 {
     // Base case: Check if the starting cell is out of bounds or not the target value
     if (start_x < 0 || start_x >= ROWS || start_y < 0 || start_y >= COLUMNS || grid[start_x][start_y] != target)
@@ -60,7 +157,7 @@ void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int targe
 
     // Replace the starting cell with the replacement value
     grid[start_x][start_y] = replacement;
-    print_grid(grid);
+    RECORD_STEP(trace, start_x, start_y);
 
     // Process the queue until it is empty
     while (!q.empty())
@@ -81,7 +178,7 @@ void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int targe
             {
                 // Replace the neighbor with the replacement value
                 grid[nx][ny] = replacement;
-                print_grid(grid);
+                RECORD_STEP(trace, nx, ny);
 
                 // Add the neighbor to the queue
                 q.push({nx, ny});
@@ -90,8 +187,297 @@ void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int targe
     }
 }
 
-int main()
+// Function run by each worker of a thread pool: wait for a job, run it, repeat until the pool stops
+void thread_pool_worker(thread_pool_data &pool, int index)
+{
+    long jobs_done = 0;
+    while (true)
+    {
+        unique_lock<mutex> guard(pool.lock);
+        pool.wake.wait(guard, [&]()
+                       { return pool.is_stopping || pool.job_number > jobs_done; });
+        if (pool.is_stopping)
+            return;
+        jobs_done = pool.job_number;
+        guard.unlock();
+
+        pool.job(index);
+
+        guard.lock();
+        if (--pool.running == 0)
+            pool.finished.notify_one();
+    }
+}
+
+// Function to start a thread pool with the given number of threads (counting the caller)
+void init_thread_pool(thread_pool_data &pool, int size)
+{
+    pool.size = max(size, 1);
+    pool.job_number = 0;
+    pool.running = 0;
+    pool.is_stopping = false;
+    pool.barrier_count.store(0);
+    pool.barrier_generation.store(0);
+    for (int i = 1; i < pool.size; i++)
+    {
+        pool.workers.push_back(thread(thread_pool_worker, ref(pool), i));
+    }
+}
+
+// Function to run a job on every thread of the pool and wait until all of them have finished it
+void run_on_pool(thread_pool_data &pool, function<void(int)> job)
+{
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.job = job;
+        pool.running = pool.size - 1;
+        pool.job_number++;
+    }
+    pool.wake.notify_all();
+
+    job(0);
+
+    unique_lock<mutex> guard(pool.lock);
+    pool.finished.wait(guard, [&]()
+                       { return pool.running == 0; });
+}
+
+// Function to wait inside a job until every thread of the pool has reached this point
+void pool_barrier(thread_pool_data &pool)
+{
+    long generation = pool.barrier_generation.load(memory_order_acquire);
+    if (pool.barrier_count.fetch_add(1, memory_order_acq_rel) == pool.size - 1)
+    {
+        pool.barrier_count.store(0, memory_order_relaxed);
+        pool.barrier_generation.fetch_add(1, memory_order_release);
+    }
+    else
+    {
+        while (pool.barrier_generation.load(memory_order_acquire) == generation)
+        {
+            this_thread::yield();
+        }
+    }
+}
+
+// Function to stop the threads of a pool
+void stop_thread_pool(thread_pool_data &pool)
+{
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.is_stopping = true;
+    }
+    pool.wake.notify_all();
+    for (size_t i = 0; i < pool.workers.size(); i++)
+    {
+        pool.workers[i].join();
+    }
+    pool.workers.clear();
+}
+
+// Structure to represent the shared state of one parallel fill (cells are numbered x * COLUMNS + y)
+struct parallel_fill_data
+{
+    vector<atomic<uint64_t>> visited;        // One bit per cell: set once a thread has claimed the cell
+    vector<atomic<uint64_t>> frontier_bits;  // One bit per cell of the current frontier (only filled for bottom-up passes)
+    vector<uint32_t> frontier;               // Cells of the current frontier
+    vector<vector<uint32_t>> local_next;     // Cells each thread added to the next frontier
+    vector<size_t> offsets;                  // Where each thread's cells go in the next frontier
+    atomic<size_t> next_chunk;               // Next frontier position to hand out
+    size_t frontier_size;                    // Number of cells in the current frontier
+    size_t visited_count;                    // Number of cells claimed so far
+    bool is_bottom_up;                       // Flag to indicate if the current level is a bottom-up pass
+};
+
+// Function to claim a cell for the fill (returns false if another thread got there first)
+inline bool claim_cell(parallel_fill_data &fill, uint32_t cell)
+{
+    uint64_t bit = 1ULL << (cell & 63);
+    if (fill.visited[cell >> 6].load(memory_order_relaxed) & bit)
+        return false;
+    return !(fill.visited[cell >> 6].fetch_or(bit, memory_order_relaxed) & bit);
+}
+
+// Function to check if a cell is in a bitmap
+inline bool has_cell(const vector<atomic<uint64_t>> &bits, uint32_t cell)
 {
+    return (bits[cell >> 6].load(memory_order_relaxed) >> (cell & 63)) & 1;
+}
+
+// Function to expand the frontier top-down: threads claim chunks of the frontier and claim its unvisited target neighbours
+void fill_top_down(int grid[ROWS][COLUMNS], parallel_fill_data &fill, int target, vector<uint32_t> &next)
+{
+    size_t start;
+    while ((start = fill.next_chunk.fetch_add(PARALLEL_CHUNK_SIZE, memory_order_relaxed)) < fill.frontier_size)
+    {
+        size_t end = min(start + PARALLEL_CHUNK_SIZE, fill.frontier_size);
+        for (size_t i = start; i < end; i++)
+        {
+            int x = fill.frontier[i] / COLUMNS;
+            int y = fill.frontier[i] % COLUMNS;
+            for (int j = 0; j < 8; j++)
+            {
+                int nx = x + DX[j];
+                int ny = y + DY[j];
+                if (nx >= 0 && nx < ROWS && ny >= 0 && ny < COLUMNS && grid[nx][ny] == target)
+                {
+                    uint32_t cell = static_cast<uint32_t>(nx * COLUMNS + ny);
+                    if (claim_cell(fill, cell))
+                        next.push_back(cell);
+                }
+            }
+        }
+    }
+}
+
+// Function to expand the frontier bottom-up: each thread scans its share of the grid for unvisited target cells next to the frontier
+void fill_bottom_up(int grid[ROWS][COLUMNS], parallel_fill_data &fill, int target, vector<uint32_t> &next, int index, int threads)
+{
+    size_t cells = static_cast<size_t>(ROWS) * COLUMNS;
+    uint32_t start = static_cast<uint32_t>(cells * index / threads);
+    uint32_t end = static_cast<uint32_t>(cells * (index + 1) / threads);
+
+    for (uint32_t cell = start; cell < end; cell++)
+    {
+        int x = cell / COLUMNS;
+        int y = cell % COLUMNS;
+        if (grid[x][y] != target || has_cell(fill.visited, cell))
+            continue;
+
+        for (int j = 0; j < 8; j++)
+        {
+            int nx = x + DX[j];
+            int ny = y + DY[j];
+            if (nx >= 0 && nx < ROWS && ny >= 0 && ny < COLUMNS && has_cell(fill.frontier_bits, static_cast<uint32_t>(nx * COLUMNS + ny)))
+            {
+                claim_cell(fill, cell);
+                next.push_back(cell);
+                break;
+            }
+        }
+    }
+}
+
+// Function to set or clear the frontier's bits, shared out in chunks between the threads
+void mark_frontier_bits(parallel_fill_data &fill, bool is_set)
+{
+    size_t start;
+    while ((start = fill.next_chunk.fetch_add(PARALLEL_CHUNK_SIZE, memory_order_relaxed)) < fill.frontier_size)
+    {
+        size_t end = min(start + PARALLEL_CHUNK_SIZE, fill.frontier_size);
+        for (size_t i = start; i < end; i++)
+        {
+            uint32_t cell = fill.frontier[i];
+            if (is_set)
+                fill.frontier_bits[cell >> 6].fetch_or(1ULL << (cell & 63), memory_order_relaxed);
+            else
+                fill.frontier_bits[cell >> 6].fetch_and(~(1ULL << (cell & 63)), memory_order_relaxed);
+        }
+    }
+}
+
+// Level-synchronous parallel implementation of Flood Fill (fills the same cells as the serial versions)
+// Each BFS level is expanded by every thread of the pool, top-down or, when the frontier is large, bottom-up (direction-optimising BFS).
+// The grid is only read while searching and written once at the end, so threads never race on it.
+void flood_fill_parallel(int grid[ROWS][COLUMNS], int start_x, int start_y, int target, int replacement, thread_pool_data &pool)
+{
+    // Base case: Check if the starting cell is out of bounds or not the target value
+    if (start_x < 0 || start_x >= ROWS || start_y < 0 || start_y >= COLUMNS || grid[start_x][start_y] != target)
+        return;
+
+    size_t cells = static_cast<size_t>(ROWS) * COLUMNS;
+    size_t words = (cells + 63) / 64;
+    int threads = pool.size;
+
+    parallel_fill_data fill;
+    fill.visited = vector<atomic<uint64_t>>(words);
+    fill.frontier_bits = vector<atomic<uint64_t>>(words);
+    fill.local_next.resize(threads);
+    fill.offsets.resize(threads);
+    fill.next_chunk.store(0);
+
+    uint32_t start_cell = static_cast<uint32_t>(start_x * COLUMNS + start_y);
+    claim_cell(fill, start_cell);
+    fill.frontier.push_back(start_cell);
+    fill.frontier_size = 1;
+    fill.visited_count = 1;
+    fill.is_bottom_up = false;
+
+    run_on_pool(pool, [&](int index)
+                {
+        vector<uint32_t> &next = fill.local_next[index];
+
+        while (fill.frontier_size > 0)
+        {
+            if (fill.is_bottom_up)
+            {
+                mark_frontier_bits(fill, true);
+                pool_barrier(pool);
+                fill_bottom_up(grid, fill, target, next, index, threads);
+                pool_barrier(pool);
+                if (index == 0)
+                    fill.next_chunk.store(0, memory_order_relaxed);
+                pool_barrier(pool);
+                mark_frontier_bits(fill, false);
+            }
+            else
+            {
+                fill_top_down(grid, fill, target, next);
+            }
+            pool_barrier(pool);
+
+            // One thread lays out the next frontier and picks the direction of the next level
+            if (index == 0)
+            {
+                size_t next_size = 0;
+                for (int i = 0; i < threads; i++)
+                {
+                    fill.offsets[i] = next_size;
+                    next_size += fill.local_next[i].size();
+                }
+                if (fill.frontier.size() < next_size)
+                    fill.frontier.resize(next_size);
+
+                fill.visited_count += next_size;
+                size_t unvisited = cells - fill.visited_count;
+                fill.is_bottom_up = next_size * BOTTOM_UP_ALPHA > unvisited && next_size * BOTTOM_UP_BETA > cells;
+                fill.frontier_size = next_size;
+                fill.next_chunk.store(0, memory_order_relaxed);
+            }
+            pool_barrier(pool);
+
+            copy(next.begin(), next.end(), fill.frontier.begin() + fill.offsets[index]);
+            next.clear();
+            pool_barrier(pool);
+        }
+
+        // Write the replacement into every claimed cell, each thread over its own share of the grid
+        size_t first_word = words * index / threads;
+        size_t last_word = words * (index + 1) / threads;
+        for (size_t w = first_word; w < last_word; w++)
+        {
+            uint64_t bits = fill.visited[w].load(memory_order_relaxed);
+            for (int b = 0; bits != 0; b++, bits >>= 1)
+            {
+                if (bits & 1)
+                {
+                    size_t cell = w * 64 + b;
+                    grid[cell / COLUMNS][cell % COLUMNS] = replacement;
+                }
+            }
+        } });
+}
+
+} // namespace flood_fill
+
+#ifndef FLOODFILL_NO_MAIN
+using namespace flood_fill;
+
+// Main function to run both fills and record their traces (pass a file prefix to choose where the traces go; replay them with flood_fill_replay)
+int main(int argc, char *argv[])
+{
+    string trace_prefix = argc >= 2 ? argv[1] : "flood_fill";
+
     // The grid that represents the game area
     int grid1[ROWS][COLUMNS] = {
         {1, 1, 1, 0, 0},
@@ -115,12 +501,30 @@ int main()
         {1, 1, 1, 1, 1}};
 
     // Perform Flood Fill using DFS
-    cout << "Flood Fill using DFS: " << endl;
-    flood_fill_dfs(grid1, 1, 1, 1, 2);
+    step_trace_data dfs_trace;
+    init_trace(dfs_trace, grid1, 2);
+    flood_fill_dfs(grid1, 1, 1, 1, 2, &dfs_trace);
+    if (write_trace(dfs_trace, trace_prefix + "-dfs.trace"))
+    {
+        cout << "Flood Fill using DFS: " << dfs_trace.count << " steps recorded to " << trace_prefix << "-dfs.trace\n";
+    }
+
+    // Perform Flood Fill in parallel and check it against the serial DFS (grid2 starts out the same as grid1)
+    thread_pool_data pool;
+    init_thread_pool(pool, 2);
+    flood_fill_parallel(grid2, 1, 1, 1, 2, pool);
+    stop_thread_pool(pool);
+    cout << "Parallel Flood Fill matches DFS: " << (equal(&grid1[0][0], &grid1[0][0] + ROWS * COLUMNS, &grid2[0][0]) ? "yes" : "no") << "\n";
 
     // Perform Flood Fill using BFS
-    cout << "Flood Fill using BFS: " << endl;
-    flood_fill_bfs(grid3, 1, 1, 1, 2);
+    step_trace_data bfs_trace;
+    init_trace(bfs_trace, grid3, 2);
+    flood_fill_bfs(grid3, 1, 1, 1, 2, &bfs_trace);
+    if (write_trace(bfs_trace, trace_prefix + "-bfs.trace"))
+    {
+        cout << "Flood Fill using BFS: " << bfs_trace.count << " steps recorded to " << trace_prefix << "-bfs.trace\n";
+    }
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,92 @@
+// Flood fill over a fixed-size grid: serial DFS/BFS, a parallel BFS on a thread pool, and a trace recorder for replaying fills.
+// The grid size is fixed at compile time (FLOODFILL_GRID_SIZE), so FloodFill.cpp is compiled into each target with that target's size.
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace flood_fill
+{
+
+// Dimensions of the grid (benchmark builds override the size)
+#ifndef FLOODFILL_GRID_SIZE
+#define FLOODFILL_GRID_SIZE 5
+#endif
+const int ROWS = FLOODFILL_GRID_SIZE;
+const int COLUMNS = FLOODFILL_GRID_SIZE;
+
+const uint32_t TRACE_MAGIC = 0x46465452;   // Marker at the start of a trace file
+const int TRACE_MAX_SIDE = 65536;          // Steps store rows and columns in 16 bits
+const int64_t TRACE_MAX_CELLS = 1LL << 28; // Largest grid a trace file may hold (1 GiB of cells)
+
+// Structure to represent one recorded cell change
+struct trace_step_data
+{
+    uint16_t x;    // Row of the changed cell
+    uint16_t y;    // Column of the changed cell
+    uint32_t step; // Position of the change within the fill
+};
+
+// Structure to represent the trace of one fill: the grid it started from and every cell it changed, in order
+struct step_trace_data
+{
+    int rows;                           // Number of rows in the grid
+    int columns;                        // Number of columns in the grid
+    int replacement;                    // Value every recorded cell was changed to
+    std::vector<int> initial;           // Grid before the fill, row by row
+    std::vector<trace_step_data> steps; // Recorded changes (room for one per cell is allocated up front)
+    uint32_t count;                     // Number of recorded changes
+};
+
+// Structure to represent a pool of threads that all run the same job, each with its own index (the calling thread is index 0)
+struct thread_pool_data
+{
+    int size;                             // Number of threads, counting the caller
+    std::vector<std::thread> workers;     // The other threads
+    std::mutex lock;                      // Guards the fields below
+    std::condition_variable wake;         // Signalled when a job is posted or the pool stops
+    std::condition_variable finished;     // Signalled when the last worker finishes a job
+    std::function<void(int)> job;         // Job every thread runs
+    long job_number;                      // Number of jobs posted so far
+    int running;                          // Workers still running the current job
+    bool is_stopping;                     // Flag to tell the workers to exit
+    std::atomic<int> barrier_count;       // Threads waiting at the barrier
+    std::atomic<long> barrier_generation; // Number of times the barrier has opened
+};
+
+// Function to start a trace for a fill of the given grid
+void init_trace(step_trace_data &trace, int grid[ROWS][COLUMNS], int replacement);
+
+// Function to write a trace to a binary file
+bool write_trace(const step_trace_data &trace, const std::string &file_name);
+
+// Function to read a trace written by write_trace
+bool read_trace(step_trace_data &trace, const std::string &file_name);
+
+// Recursive implementation of Flood Fill using Depth-First Search (DFS)
+void flood_fill_dfs(int grid[ROWS][COLUMNS], int x, int y, int target, int replacement, step_trace_data *trace = nullptr);
+
+// Iterative implementation of Flood Fill using Breadth-First Search (BFS)
+void flood_fill_bfs(int grid[ROWS][COLUMNS], int start_x, int start_y, int target, int replacement, step_trace_data *trace = nullptr);
+
+// Function to start a thread pool with the given number of threads (counting the caller)
+void init_thread_pool(thread_pool_data &pool, int size);
+
+// Function to run a job on every thread of the pool and wait until all of them have finished it
+void run_on_pool(thread_pool_data &pool, std::function<void(int)> job);
+
+// Function to wait inside a job until every thread of the pool has reached this point
+void pool_barrier(thread_pool_data &pool);
+
+// Function to stop the threads of a pool
+void stop_thread_pool(thread_pool_data &pool);
+
+// Level-synchronous parallel implementation of Flood Fill (fills the same cells as the serial versions)
+void flood_fill_parallel(int grid[ROWS][COLUMNS], int start_x, int start_y, int target, int replacement, thread_pool_data &pool);
+
+} // namespace flood_fill
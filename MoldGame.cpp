@@ -3,19 +3,50 @@
 #include <queue>
 #include <fstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <new>
+#include <cstdlib>
+#include "FloodFill.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 using std::to_string;
+using namespace std::chrono;
 
 // Constants for window size and map dimensions
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
-const int MAX_MAP_ROWS = 40;
-const int MAX_MAP_COLS = 40;
+#ifndef MOLDBOUND_MAP_SIZE
+#define MOLDBOUND_MAP_SIZE 40 // Benchmark builds override the map size
+#endif
+const int MAX_MAP_ROWS = MOLDBOUND_MAP_SIZE;
+const int MAX_MAP_COLS = MOLDBOUND_MAP_SIZE;
 const int TILE_WIDTH = 30;
 const int TILE_HEIGHT = 30;
-
-// Constants for the game's resources
+const int ZOOM_LEVELS = 7;
+const int ZOOM_TILE_SIZES[ZOOM_LEVELS] = {60, 30, 15, 8, 4, 2, 1}; // On-screen tile size for each zoom level
+const int DEFAULT_ZOOM_LEVEL = 1;                                   // Zoom level that matches TILE_WIDTH and TILE_HEIGHT
+const int LOD_MIN_BLOCK_SIZE = 4;                                   // Below this size, tiles are drawn as averaged blocks
+const int LOD_LEVELS = 2;
+const int LOD_BLOCK_SIZES[LOD_LEVELS] = {2, 4};                     // Tiles per block side at each level of detail (for tile sizes 2 and 1)
+const int LOD_MAX_BLOCKS = (MOLDBOUND_MAP_SIZE + 1) / 2;            // Blocks per map side at the finest level of detail (the map is square)
+
+// Constants for the game's resources (loaded once, then always used by handle rather than by name)
 const music GAME_MUSIC = load_music("Game Music", "audio-resources\\game-music.mp3");
 const sound_effect DRAWING_SOUND = load_sound_effect("Drawing Sound", "audio-resources\\drawing-sound.mp3");
 const bitmap MOLD_PIC = load_bitmap("Mold Pic", "images-resources\\mold_pic.png");
@@ -26,11 +57,52 @@ const font TEXT_FONT = load_font("Text Font", "other-resources\\DynaPuff-Variabl
 const double MUSIC_VOLUME = 0.3;
 
 // Constants for the game
-const string GAME_TIMER = "Game Timer";
+const timer GAME_TIMER = create_timer("Game Timer");
 const long MOLD_SPREAD_TIME = 1000; // Time interval for mold spreading
 const long MOLD_FIX_TIME = 5000;   // Time interval for mold fixing
 const long GAME_UPDATE_INTERVAL = 20000; // Interval for updating game difficulty
-const string SCORE_FILE = "scores.txt";   // File to store scores
+const string SCORE_FILE = "scores.dat";   // Append-only binary log of every score
+const string LEGACY_SCORE_FILE = "scores.txt"; // Plain text scores from older versions, imported once
+const string LEGACY_IMPORT_MARKER = "scores.imported"; // Created by the one game instance that imports the legacy scores
+const int SCORE_INDEX_SIZE = 16384;          // Number of score buckets in each index (scores from 16383 up share the last one)
+const uint32_t SCORE_INDEX_MAGIC = 0x4D4F4C44; // Marker at the start of a valid index file
+const int MAX_MOLD_IDS = 256;   // Mold ids fit in one byte per tile (0 means no owner)
+const int THREAT_UNREACHABLE = MAX_MAP_COLS * MAX_MAP_ROWS; // Distance for tiles no mold can reach
+
+// Constants for frame pacing
+const int TARGET_FPS = 60;            // Frame rate while the player is interacting
+const int IDLE_FPS = 30;              // Frame rate while nothing on screen is changing
+const long FRAME_SPIN_MARGIN_US = 2000; // Final part of each wait spent spinning instead of sleeping, for accuracy
+
+// Constants for the simulation thread
+const int THREAT_POOL_THREADS = 4;          // Most threads (counting the simulation thread) that share a large threat relax
+const int THREAT_PARALLEL_MIN_REGION = 4096; // Reset regions of the threat heat-map at least this big are relaxed on the pool
+const size_t THREAT_CHUNK_SIZE = 256;        // Frontier tiles a thread takes at a time during a parallel relax
+const int EDITOR_QUEUE_CAPACITY = 1024; // Edits waiting for the simulation thread (further edits are dropped until it catches up)
+const int EDITOR_CONTROL_SLOTS = 64;    // Queue slots tile edits may not use, kept for ending strokes, undo and redo
+const int SNAPSHOT_FRESH_BIT = 4;       // Set on the shared snapshot slot when it holds a snapshot the main thread has not taken yet
+const int SNAPSHOT_SLOT_MASK = 3;       // Bits of the shared snapshot slot that hold the slot number
+
+// Constants for the editor history
+const int HISTORY_RUN_CAPACITY = 65536;  // Runs of changed tiles kept for undo (the oldest strokes are forgotten first)
+const int HISTORY_STROKE_CAPACITY = 4096; // Brush strokes kept for undo
+const int MAX_RUN_LENGTH = 65535;        // Longest run one history entry can hold
+
+// Constants for the stochastic spread model
+const double STOCHASTIC_SPREAD_CHANCE[4] = {0.25, 0.35, 0.5, 0.35}; // Chance per tick that one moldy neighbour infects a normal tile (EASY, MEDIUM, HARD, UNRATED)
+const uint32_t PHILOX_M0 = 0xD2511F53;                              // Philox4x32 round multipliers
+const uint32_t PHILOX_M1 = 0xCD9E8D57;
+const uint32_t PHILOX_W0 = 0x9E3779B9;                              // Philox4x32 key increments
+const uint32_t PHILOX_W1 = 0xBB67AE85;
+const int PHILOX_ROUNDS = 10;
+
+// Constants for allocation tracking (only in builds with MOLDBOUND_ALLOC_TRACKING)
+#ifdef MOLDBOUND_ALLOC_TRACKING
+const int MAX_ALLOC_SCOPES = 48;                     // Functions the tracker can tell apart (later ones count as untracked)
+const int ALLOC_SCOPE_IGNORED = -1;                  // Scope whose allocations are not counted (the tracker's own overlay)
+const int ALLOC_OVERLAY_SCOPES = 5;                  // Busiest functions listed on the overlay
+const string ALLOC_REPORT_FILE = "alloc-report.json"; // Report written when the game exits
+#endif
 
 // Constants for the interface
 const int BUTTON_WIDTH = 150;
@@ -50,6 +122,16 @@ enum tile_kind
     BROKEN_TILE,
     BORDER_TILE
 };
+const int TILE_KIND_COUNT = 5;
+
+// Color of each tile kind, looked up by kind
+const color TILE_PALETTE[TILE_KIND_COUNT] = {
+    color_burly_wood(),        // NORMAL_TILE
+    color_dark_olive_green(),  // MOLDY_TILE
+    color_yellow_green(),      // FIX_TILE
+    color_gray(),              // BROKEN_TILE
+    color_black()              // BORDER_TILE
+};
 
 // Enum for mold states
 enum mold_state
@@ -61,6 +143,40 @@ enum mold_state
     BROKEN
 };
 
+// Enum for difficulty levels (UNRATED holds scores imported from older versions)
+enum difficulty_level
+{
+    EASY,
+    MEDIUM,
+    HARD,
+    UNRATED
+};
+const int DIFFICULTY_COUNT = 4;
+
+// Enum for the ways molds can grow
+enum spread_model
+{
+    BFS_SPREAD,       // Each spread step infects every normal neighbour of the next frontier tile
+    STOCHASTIC_SPREAD // Each tick, every normal tile may be infected, more likely the more moldy neighbours it has
+};
+
+// Enum for the ways a frame can be drawn
+enum render_backend
+{
+    SPLASHKIT_BACKEND, // Draw to the SplashKit window
+    SOFTWARE_BACKEND   // Draw to an in-memory framebuffer (no window needed)
+};
+
+// Enum for where a mold is relative to the visible map
+enum mold_visibility_kind
+{
+    OFF_LEFT,
+    OFF_RIGHT,
+    OFF_TOP,
+    OFF_BOTTOM,
+    VISIBLE
+};
+
 // Enum for game states
 enum game_state
 {
@@ -70,24 +186,207 @@ enum game_state
     GAME_OVER,
     QUIT
 };
+
+// Count allocations and large copies per function and per frame (compiled out unless MOLDBOUND_ALLOC_TRACKING is defined)
+#ifdef MOLDBOUND_ALLOC_TRACKING
+// Structure to represent allocation and copy counts
+struct alloc_counts_data
+{
+    long allocations;  // Calls to operator new
+    long bytes;        // Bytes those calls asked for
+    long copies;       // Copies of large structs (map, threat heat-map, mold)
+    long copied_bytes; // Bytes those copies moved
+};
+
+// Structure to represent the counters of one tracked function
+// Any thread may add to the frame counters; only the main thread reads them, once per frame.
+struct alloc_scope_data
+{
+    const char *name;               // Function the counters belong to (nullptr for untracked code)
+    atomic<long> frame_allocations; // Counts of the frame in progress
+    atomic<long> frame_bytes;
+    atomic<long> frame_copies;
+    atomic<long> frame_copied_bytes;
+    alloc_counts_data last;  // Counts of the last finished frame
+    alloc_counts_data total; // Counts of every finished frame
+    alloc_counts_data peak;  // Highest counts of any one frame
+};
+
+// Structure to represent the allocation tracker (scope 0 collects everything outside a tracked function)
+struct alloc_tracker_data
+{
+    alloc_scope_data scopes[MAX_ALLOC_SCOPES];
+    atomic<int> scope_count;      // Number of scopes handed out, besides scope 0
+    long frames;                  // Number of finished frames
+    long quiet_frames;            // Number of finished frames without any allocation or large copy
+    alloc_counts_data last_frame; // Counts of the last finished frame over all scopes
+    bool show_overlay;            // Flag to indicate if the debug overlay is drawn
+};
+
+// The allocation tracker (zero-initialised before any constructor runs, so allocations during start-up are counted safely)
+alloc_tracker_data alloc_tracker;
+
+// Scope the current thread's allocations and copies are counted in
+thread_local int current_alloc_scope = 0;
+
+// Function to hand out a scope for a tracked function (called once per function)
+int register_alloc_scope(const char *name)
+{
+    int scope = alloc_tracker.scope_count.fetch_add(1) + 1;
+    if (scope >= MAX_ALLOC_SCOPES)
+    {
+        return 0;
+    }
+    alloc_tracker.scopes[scope].name = name;
+    return scope;
+}
+
+// Function to count one allocation in the current scope
+void count_allocation(size_t size)
+{
+    int scope = current_alloc_scope;
+    if (scope == ALLOC_SCOPE_IGNORED)
+    {
+        return;
+    }
+    alloc_tracker.scopes[scope].frame_allocations.fetch_add(1, memory_order_relaxed);
+    alloc_tracker.scopes[scope].frame_bytes.fetch_add(static_cast<long>(size), memory_order_relaxed);
+}
+
+// Function to count one copy of a large struct in the current scope
+void count_large_copy(size_t size)
+{
+    int scope = current_alloc_scope;
+    if (scope == ALLOC_SCOPE_IGNORED)
+    {
+        return;
+    }
+    alloc_tracker.scopes[scope].frame_copies.fetch_add(1, memory_order_relaxed);
+    alloc_tracker.scopes[scope].frame_copied_bytes.fetch_add(static_cast<long>(size), memory_order_relaxed);
+}
+
+// Structure to represent a tracked function call: its allocations count in its scope until it returns
+struct alloc_scope_guard
+{
+    int previous; // Scope of the caller
+
+    alloc_scope_guard(int scope) : previous(current_alloc_scope)
+    {
+        current_alloc_scope = scope;
+    }
+
+    ~alloc_scope_guard()
+    {
+        current_alloc_scope = previous;
+    }
+};
+
+// Structure to represent a member that counts every copy of the struct T it is part of
+template <typename T>
+struct copy_counter_data
+{
+    copy_counter_data() {}
+
+    copy_counter_data(const copy_counter_data &)
+    {
+        count_large_copy(sizeof(T));
+    }
+
+    copy_counter_data &operator=(const copy_counter_data &)
+    {
+        count_large_copy(sizeof(T));
+        return *this;
+    }
+};
+
+#define TRACK_ALLOCATIONS(name)                                   \
+    static const int alloc_scope_id = register_alloc_scope(name); \
+    alloc_scope_guard alloc_scope(alloc_scope_id)
+#define COUNT_COPIES(type) copy_counter_data<type> copy_counter;
+
+void *operator new(size_t size)
+{
+    count_allocation(size);
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+#else
+#define TRACK_ALLOCATIONS(name)
+#define COUNT_COPIES(type)
+#endif
+
 // Structure to represent a single tile
 struct tile_data
 {
     tile_kind kind;
 };
 
+// Packed tile indices use 16 bits when the map is small enough, 32 bits otherwise
+typedef conditional<MAX_MAP_COLS * MAX_MAP_ROWS <= 65536, uint16_t, uint32_t>::type frontier_index;
+
 // Structure to represent the map, which is a grid of tiles
 struct map_data
 {
     tile_data tiles[MAX_MAP_COLS][MAX_MAP_ROWS];
+    uint8_t owner[MAX_MAP_COLS][MAX_MAP_ROWS];             // ID of the mold that owns each MOLDY or FIX tile (0 for none)
+    frontier_index live_slot[MAX_MAP_COLS][MAX_MAP_ROWS];  // Position of each owned tile in its mold's live list
+    vector<frontier_index> live_tiles[MAX_MOLD_IDS];       // Packed MOLDY or FIX tiles each mold ID still owns, in no order
+    uint8_t lod_counts[LOD_LEVELS][LOD_MAX_BLOCKS][LOD_MAX_BLOCKS][TILE_KIND_COUNT]; // Number of tiles of each kind in each block, per level of detail
+    COUNT_COPIES(map_data)
+};
+
+// Structure to represent the threads and scratch space for relaxing a large reset region of the threat heat-map in parallel
+struct threat_parallel_data
+{
+    flood_fill::thread_pool_data pool;   // Threads that share each relax (the simulation thread is index 0)
+    vector<atomic<uint64_t>> claimed;    // Tiles lowered during the current level, one bit per tile (all clear between levels)
+    vector<uint32_t> frontier;           // Tiles at the current level's distance (c * MAX_MAP_ROWS + r)
+    size_t frontier_size;                // Number of tiles in the frontier
+    vector<vector<uint32_t>> local_next; // Tiles each thread lowered to the next distance
+    vector<size_t> offsets;              // Where each thread's tiles start in the next frontier
+    atomic<size_t> next_chunk;           // Start of the next chunk of the frontier to expand
+};
+
+// Structure to represent the threat heat-map: how many spread steps until each tile is reached
+struct threat_data
+{
+    int dist[MAX_MAP_COLS][MAX_MAP_ROWS];        // Steps from the nearest mold frontier
+    bool is_source[MAX_MAP_COLS][MAX_MAP_ROWS]; // Whether the tile is in a mold's BFS frontier
+    threat_parallel_data *parallel;             // Threads for large reset regions (nullptr relaxes on the calling thread; snapshots never use it)
+
+    // Scratch buffers for the updates below (empty between calls; kept so updates do not allocate once they have grown)
+    vector<pair<int, int>> pending; // Tiles whose distance still has to be passed on to their neighbors, in order
+    vector<pair<int, int>> invalid; // Tiles whose distance may have come through a closed tile
+    vector<int> invalid_dist;       // Distance each invalid tile had before it was reset
+    vector<pair<int, int>> region;  // Tiles reset by a closed tile
+    COUNT_COPIES(threat_data)
 };
 
 // Structure to represent the explorer, including the map and camera position
 struct explorer_data
 {
     map_data map;
+    threat_data threat; // Threat heat-map kept in sync with the map and mold frontiers
+    bool show_threat;   // Flag to indicate if the threat overlay is drawn
     tile_kind editor_tile_kind;
+    bool is_drawing; // Flag to indicate if a brush stroke is in progress
     point_2d camera;
+    int zoom_level; // Index into ZOOM_TILE_SIZES
+    int tile_size;  // Size of a tile on screen at the current zoom level
 };
 
 // Structure to represent a location on the map
@@ -97,10 +396,69 @@ struct location_data
     int r; // Row
 };
 
+// Structure to represent a mold's BFS frontier as a growable buffer of packed tile indices (c * MAX_MAP_ROWS + r)
+// Popped tiles stay in the buffer, so cells[0 .. size) also lists every tile the mold spread to
+// The buffer only grows as far as the mold does, and keeps its capacity when the mold is reset or handed to a new mold
+struct frontier_data
+{
+    vector<frontier_index> cells; // Packed tile indices
+    int head = 0;                 // Index of the front tile
+
+    // Check if the frontier has no tiles left
+    bool empty() const
+    {
+        return head == cells.size();
+    }
+
+    // Add a tile to the back of the frontier
+    void push(int c, int r)
+    {
+        cells.push_back(static_cast<frontier_index>(c * MAX_MAP_ROWS + r));
+    }
+
+    // Remove the front tile
+    void pop()
+    {
+        head++;
+    }
+
+    // Remove every tile, keeping the buffer's capacity
+    void clear()
+    {
+        cells.clear();
+        head = 0;
+    }
+
+    // Get the column of the front tile
+    int front_c() const
+    {
+        return cells[head] / MAX_MAP_ROWS;
+    }
+
+    // Get the row of the front tile
+    int front_r() const
+    {
+        return cells[head] % MAX_MAP_ROWS;
+    }
+
+    // Get the column of the i-th tile ever added
+    int cell_c(int i) const
+    {
+        return cells[i] / MAX_MAP_ROWS;
+    }
+
+    // Get the row of the i-th tile ever added
+    int cell_r(int i) const
+    {
+        return cells[i] % MAX_MAP_ROWS;
+    }
+};
+
 // Structure to represent the mold and its behavior
 struct mold_data
 {
     location_data start_loc; // Starting location of the mold
+    uint8_t id;              // ID marking the tiles this mold owns
 
     mold_state state; // Current state of the mold
 
@@ -108,10 +466,11 @@ struct mold_data
     long last_spread_time;  // Last time mold spread
     long time_to_start_fix; // Time to start fixing mold
 
-    location_data spread[MAX_MAP_COLS * MAX_MAP_ROWS]; // Array to track spreads locations
-    int spreads_count;                                 // Counter for the number of spreads
+    int spreads_count;  // Counter for the number of spreads
+    spread_model model; // How the mold grows
 
-    queue<pair<int, int>> q; // Queue for BFS during spreading
+    frontier_data q; // Frontier for BFS during spreading (also the list of spread tiles)
+    COUNT_COPIES(mold_data)
 
     // Check if it's time for the mold to spread
     bool is_time_to_spread(long current_time) const
@@ -125,6 +484,9 @@ struct molds_data
 {
     vector<mold_data> v;      // Vector to store current molds
     long time_to_appear_next; // Time for the next mold to appear
+    int last_id;              // Last mold ID handed out
+
+    vector<vector<frontier_index>> spare_frontiers; // Frontier buffers of removed molds, handed to new molds so they reuse the capacity
 
     // Check if it's time for the next mold to appear
     bool is_time_to_appear_next(long current_time) const
@@ -135,9 +497,29 @@ struct molds_data
 
 struct attention_data
 {
-    int new_r;         // The row to draw the attention icon at
-    int new_c;         // The column to draw the attention icon at
-    string visibility; // Visibility status (left, right, top, bottom, visible)
+    int new_r;                       // The row to draw the attention icon at
+    int new_c;                       // The column to draw the attention icon at
+    mold_visibility_kind visibility; // Which side of the screen the mold is off (or VISIBLE)
+};
+
+// Structure to represent one tile infected by the stochastic spread model
+struct infection_data
+{
+    int c;         // Column of the infected tile
+    int r;         // Row of the infected tile
+    uint8_t owner; // ID of the mold the tile joins
+};
+
+// Structure to represent the state of the stochastic spread model
+struct stochastic_spread_data
+{
+    uint64_t seed;                      // Seed of the game (the same seed and moves always grow the same molds)
+    uint32_t thresholds[9];             // Chance (out of 2^32) that a normal tile with k moldy neighbours is infected in one tick
+    long last_tick;                     // Last tick that was simulated
+    vector<uint8_t> moldy[3];           // Moldy flags of the previous, current and next column of the swept region
+    vector<uint8_t> column_sums;        // Moldy tiles in each row of those three columns
+    vector<uint8_t> neighbours;         // Moldy neighbours of each tile in the current column
+    vector<infection_data> infections;  // Tiles infected this tick, applied once the whole region has been swept
 };
 
 // Structure to represent the current game data
@@ -148,791 +530,3092 @@ struct game_data
     molds_data molds;           // Data for the molds
     long mold_appearance_time;  // Time of mold appearance
     game_state state;           // Current state of the game
+    difficulty_level difficulty; // Difficulty chosen on the menu
+    spread_model model;          // How molds grow, chosen on the menu
+    stochastic_spread_data stochastic; // State of the stochastic spread model
     int score;                  // Score of the game
     bool is_player_score_saved; // Flag to indicate if the score is saved
+    int rank;                   // Rank of the score among all scores of the same difficulty
+    double top_percent;         // Percentage of scores of the same difficulty at or above this score
 
     // Check if the game is over (80% of tiles are broken or blocked by border tiles)
-    void if_game_over()
+    void if_game_over(long current_time)
     {
         if ((broken_proportion + border_proportion) >= 80.0)
         {
-            score = timer_ticks(GAME_TIMER) / MOLD_SPREAD_TIME; // Calculate score based on time survived (in seconds)
+            score = current_time / MOLD_SPREAD_TIME; // Calculate score based on time survived (in seconds)
             state = GAME_OVER;
         }
     }
 };
 
-// Structure to represent the game effect data (sound settings)
-struct game_effect_data
+// Structure to represent one record of the binary score log
+struct score_record
 {
-    bool is_sound_on; // Flag to indicate if sound is on
+    int32_t score;      // Score of the game
+    int32_t difficulty; // Difficulty the game was played on
+    int64_t timestamp;  // Time the score was saved (0 for imported scores)
 };
 
-// Function to save the score to a file
-bool save_score_to_file(game_data &game)
+// Structure to represent the index of all scores for one difficulty
+struct score_index_data
 {
-    ofstream score_file(SCORE_FILE, ios::app); // Open file in append mode
-    if (score_file.is_open())
-    {
-        score_file << game.score << "\n"; // Write the score to the file
-        score_file.close();
-        write_line("Score saved to score.txt");
-        return true;
-    }
-    else
-    {
-        write_line("Failed to open score.txt for writing.");
-        return false;
-    }
-}
+    difficulty_level difficulty; // Difficulty this index covers
+    long records_covered;        // Number of log records already added to the index
+    int total;                   // Number of scores in the index
+    vector<int> tree;            // Fenwick tree of score counts (entry score + 1)
+};
 
-// Function to get the top 5 highest scores from the file
-vector<int> get_top_5_scores()
+// Structure to represent the score store, with one index per difficulty
+struct score_store_data
 {
-    vector<int> scores;
-    ifstream score_file(SCORE_FILE); // Open the file in read mode
+    score_index_data indexes[DIFFICULTY_COUNT];
+};
 
-    // Read scores from the file
-    if (score_file.is_open())
-    {
-        int score;
-        while (score_file >> score)
-        {
-            scores.push_back(score);
-        }
-        score_file.close();
-    }
-    else
-    {
-        write_line("Failed to open score.txt for reading.");
-        return {}; // Return an empty vector if the file cannot be opened
-    }
+// Structure to represent a rectangle of same-kind tiles built up row by row while drawing the map
+struct tile_run_data
+{
+    int start_c;    // First column of the run
+    int end_c;      // Column just past the run
+    int start_r;    // Row the rectangle started on
+    tile_kind kind; // Kind of every tile in the rectangle
+};
 
-    // Sort the scores in descending order
-    sort(scores.begin(), scores.end(), greater<int>());
+// Structure to represent the renderer that all map and interface drawing goes through
+struct renderer_data
+{
+    render_backend backend;           // Where frames are drawn
+    int width;                        // Width of the frame in pixels
+    int height;                       // Height of the frame in pixels
+    point_2d camera;                  // World position of the top-left pixel
+    vector<uint32_t> pixels;          // Software framebuffer (0xRRGGBB, row by row)
+    vector<tile_run_data> open_runs;  // Tile rectangles still growing down the map (kept between frames so drawing does not allocate)
+    vector<tile_run_data> row_runs;   // Runs of the row being drawn
+    long fill_count;                  // Number of rectangles filled so far
+};
 
-    // Get the top 5 scores
-    if (scores.size() > 5)
+// Structure to represent the frame pacer that limits how often the main loop runs
+struct frame_pacer_data
+{
+    int target_fps;                        // Frame rate while something is animating
+    int idle_fps;                          // Frame rate while nothing is animating
+    steady_clock::time_point next_frame_at; // Time the next frame is due
+};
+
+// Structure to represent everything a frame's picture depends on, so a frame that would look the same can be skipped
+struct frame_record_data
+{
+    game_state state;           // Screen being shown
+    point_2d mouse;             // Mouse position (buttons are highlighted while hovered)
+    bool is_mouse_down;         // Buttons are drawn pressed while held and act when released
+    bool is_mouse_clicked;      // A click pressed and released between two frames leaves the mouse state unchanged
+    bool is_sound_on;           // Icon of the sound button
+    spread_model model;         // Growth model shown on the menu
+    point_2d camera;            // Camera of the playing screen
+    int tile_size;              // Zoom of the playing screen
+    bool show_threat;           // Threat overlay of the playing screen
+    tile_kind editor_tile_kind; // Tile kind shown by the editor
+    long snapshot_version;      // Snapshot drawn by the playing screen
+    bool is_player_score_saved; // Rank line of the game over screen
+
+    // Check if a frame drawn with these inputs would look the same as one drawn with the other's
+    bool same_as(const frame_record_data &other) const
     {
-        scores.resize(5);
+        return state == other.state && mouse.x == other.mouse.x && mouse.y == other.mouse.y && is_mouse_down == other.is_mouse_down &&
+               is_sound_on == other.is_sound_on && model == other.model && camera.x == other.camera.x && camera.y == other.camera.y &&
+               tile_size == other.tile_size && show_threat == other.show_threat && editor_tile_kind == other.editor_tile_kind &&
+               snapshot_version == other.snapshot_version && is_player_score_saved == other.is_player_score_saved;
     }
+};
 
-    return scores;
-}
-
-// Function to initialize a location
-location_data init_loc(int c, int r)
+// Structure to represent the frame invalidation state: what the frame on screen was drawn from
+struct frame_invalidation_data
 {
-    location_data loc;
-    loc.c = c;
-    loc.r = r;
-    return loc;
-}
+    bool is_drawn;            // Flag to indicate if a frame is on screen yet
+    frame_record_data last;   // Inputs of the frame on screen
+    long skipped_frames;      // Number of frames skipped because nothing changed
+};
 
-// Function to initialize the mold
-mold_data init_mold(int start_c, int start_r)
+// Structure to represent the game effect data (sound settings)
+struct game_effect_data
 {
-    mold_data mold;
-
-    mold.start_loc = init_loc(start_c, start_r); // Initialize starting location
-
-    mold.state = PREPARE; // Initialize state
-
-    mold.appear_at_time = timer_ticks(GAME_TIMER); // Set appearance time
-    mold.last_spread_time = 0;                     // Initialize last spread time
-    mold.time_to_start_fix = 0;                    // Initialize time to start fix
+    bool is_sound_on; // Flag to indicate if sound is on
+};
 
-    // Initialize the spread locations
-    for (int i = 0; i < MAX_MAP_COLS * MAX_MAP_ROWS; i++)
-    {
-        mold.spread[i].c = -1;
-        mold.spread[i].r = -1;
-    }
-    mold.spreads_count = 0;
+// Enum for the things the editor can ask the simulation to do
+enum editor_action
+{
+    EDIT_TILE,  // Change one tile
+    END_STROKE, // The brush was lifted, so the edits since the last stroke form one undo step
+    UNDO_STROKE,
+    REDO_STROKE
+};
 
-    return mold;
-}
+// Structure to represent one editor command
+struct editor_command_data
+{
+    editor_action action; // What to do
+    int c;                // Column of the edited tile (EDIT_TILE only)
+    int r;                // Row of the edited tile (EDIT_TILE only)
+    tile_kind kind;       // Kind the tile is changed to (EDIT_TILE only)
+};
 
-// Function to initialize the molds data
-molds_data init_molds()
+// Structure to represent a run of tiles with consecutive indices (c * MAX_MAP_ROWS + r) that one stroke changed from the same kind to the same kind
+struct delta_run_data
 {
-    molds_data molds;
-    molds.time_to_appear_next = 0;
-    return molds;
-}
+    uint32_t start;    // Index of the first tile
+    uint16_t length;   // Number of tiles
+    uint8_t old_kind;  // Kind before the stroke
+    uint8_t new_kind;  // Kind after the stroke
+};
 
-// Function to initialize the game data
-game_data init_game()
+// Structure to represent one brush stroke in the history
+struct stroke_data
 {
-    game_data game;
-    game.broken_proportion = 0.0;
-    game.border_proportion = 0.0;
-    game.molds = init_molds();
-    game.mold_appearance_time = 0;
-    game.state = PREPARE_GAME;
-    game.score = 0;
-    game.is_player_score_saved = false;
-    return game;
-}
+    long first_run; // Position of the stroke's first run
+    long run_count; // Number of runs in the stroke
+};
 
-// Function to initialize the game effect data
-game_effect_data init_game_effect()
+// Structure to represent the editor's undo/redo history as two ring buffers: delta runs, and the strokes made of them
+// Positions count up forever and are taken modulo the capacity, so the oldest strokes are overwritten once the history is full
+struct editor_history_data
 {
-    game_effect_data game_effect;
-    game_effect.is_sound_on = true;
-    return game_effect;
-}
+    vector<delta_run_data> runs;  // Ring of delta runs
+    vector<stroke_data> strokes;  // Ring of strokes
+    long oldest_run;              // Position of the oldest run still kept
+    long next_run;                // Position the next run is written to
+    long oldest_stroke;           // Position of the oldest stroke still kept
+    long undo_cursor;             // Strokes before this position are applied, the ones from it to redo_end were undone
+    long redo_end;                // One past the last stroke that can be redone
+    bool is_stroke_open;          // Flag to indicate if edits are being added to a stroke that has not ended yet
+    long open_first_run;          // Position of the first run of the open stroke
+};
 
-// Function to spread mold to neighboring tiles
-void spread_mold(map_data &map, mold_data &mold)
+// Structure to represent the queue of editor edits from the main thread to the simulation thread
+// Only the main thread pushes and only the simulation thread pops, so both ends finish in a fixed number of steps without locks
+struct editor_command_queue_data
 {
-    int c = mold.q.front().first;
-    int r = mold.q.front().second;
-    mold.q.pop();
+    editor_command_data commands[EDITOR_QUEUE_CAPACITY];
+    atomic<uint32_t> head{0}; // Number of commands popped so far (written by the simulation thread)
+    atomic<uint32_t> tail{0}; // Number of commands pushed so far (written by the main thread)
 
-    // Check current spot's 8-connected neighbors
-    for (int i = 0; i < 8; i++)
+    // Add a command to the back of the queue, leaving the given number of slots free (returns false if there is no room)
+    bool push(const editor_command_data &command, uint32_t reserved = 0)
     {
-        int nc = c + DY[i];
-        int nr = r + DX[i];
-        if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+        uint32_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) >= EDITOR_QUEUE_CAPACITY - reserved)
         {
-            // Spread the mold to the neighbor if it's a normal tile
-            if (map.tiles[nc][nr].kind == NORMAL_TILE)
-            {
-                mold.spread[mold.spreads_count++] = init_loc(nc, nr);
-                map.tiles[nc][nr].kind = MOLDY_TILE;
-                mold.q.push({nc, nr});
-                mold.last_spread_time = timer_ticks(GAME_TIMER);
-            }
+            return false;
         }
+        commands[t % EDITOR_QUEUE_CAPACITY] = command;
+        tail.store(t + 1, memory_order_release);
+        return true;
     }
 
-    // Check if the queue is empty, indicating that mold has finished spreading
-    if (mold.q.empty())
+    // Take the command at the front of the queue (returns false if the queue is empty)
+    bool pop(editor_command_data &command)
     {
-        mold.time_to_start_fix = timer_ticks(GAME_TIMER) + MOLD_FIX_TIME; // Set time to start fix
-        mold.state = DONE_SPREADING;
+        uint32_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))
+        {
+            return false;
+        }
+        command = commands[h % EDITOR_QUEUE_CAPACITY];
+        head.store(h + 1, memory_order_release);
+        return true;
     }
-}
+};
 
-// Function to handle the lifecycle of mold (appearance, spreading, fixing, breaking)
-void handle_mold_lifecycle(map_data &map, mold_data &mold)
+// Structure to represent what the main thread needs to draw one state of the simulation
+struct snapshot_data
 {
-    // Push the mold's starting position into the queue
-    if (mold.state == PREPARE)
+    map_data map;                          // Tiles and block counts of the map (the molds' ownership bookkeeping is not copied)
+    threat_data threat;
+    vector<location_data> spreading_molds; // Starting locations of the molds that are still spreading
+    double broken_proportion;              // Proportion of broken tiles
+    double border_proportion;              // Proportion of border tiles
+    bool is_game_over;                     // Flag to indicate if the game ended in this state
+    int score;                             // Score of the game (only set once it is over)
+    long version;                          // Number of snapshots published in this game up to this one, for frame invalidation
+};
+
+// Structure to represent a triple buffer of snapshots
+// The simulation thread fills its back slot and swaps it with the shared slot; the main thread swaps its front slot with the shared slot when that holds a newer snapshot.
+// Neither side ever waits, and a slot is never written while the main thread is reading it.
+struct snapshot_buffer_data
+{
+    snapshot_data slots[3];
+    atomic<int> shared{2}; // Slot passed between the threads, plus SNAPSHOT_FRESH_BIT while it holds a new snapshot
+    int back = 1;          // Slot the simulation thread writes (simulation thread only)
+    int front = 0;         // Slot the main thread reads (main thread only)
+
+    // Get the slot to write the next snapshot into
+    snapshot_data &back_slot()
     {
-        mold.q.push({mold.start_loc.c, mold.start_loc.r});
-        mold.spread[mold.spreads_count++] = mold.start_loc;
-        map.tiles[mold.start_loc.c][mold.start_loc.r].kind = MOLDY_TILE;
-        mold.last_spread_time = timer_ticks(GAME_TIMER);
-        mold.state = SPREADING;
+        return slots[back];
     }
 
-    // Spread the mold
-    if (mold.state == SPREADING && mold.is_time_to_spread(timer_ticks(GAME_TIMER)))
+    // Hand the back slot to the main thread
+    void publish()
     {
-        spread_mold(map, mold);
+        back = shared.exchange(back | SNAPSHOT_FRESH_BIT, memory_order_acq_rel) & SNAPSHOT_SLOT_MASK;
     }
 
-    // Change the mold's spread tiles to FIX_TILE when done spreading
-    if (mold.state == DONE_SPREADING)
+    // Take the newest snapshot if there is one, and get the snapshot to draw
+    const snapshot_data &acquire()
     {
-        for (int i = 0; i < mold.spreads_count; i++)
+        if (shared.load(memory_order_relaxed) & SNAPSHOT_FRESH_BIT)
         {
-            map.tiles[mold.spread[i].c][mold.spread[i].r].kind = FIX_TILE;
+            front = shared.exchange(front, memory_order_acq_rel) & SNAPSHOT_SLOT_MASK;
         }
-        mold.state = FIXING;
+        return slots[front];
     }
+};
 
-    // Change the mold's FIX_TILE to BROKEN_TILE after it's past the time to fix
-    if (mold.state == FIXING && timer_ticks(GAME_TIMER) > mold.time_to_start_fix)
+// Structure to represent the mold simulation and the thread it runs on
+struct simulation_data
+{
+    map_data map;                         // Map the simulation changes (simulation thread only)
+    threat_data threat;                   // Threat heat-map of that map (simulation thread only)
+    game_data game;                       // Molds and tile proportions (simulation thread only)
+    editor_command_queue_data commands;   // Edits from the main thread
+    editor_history_data history;          // Undo/redo history of the applied edits (simulation thread only)
+    threat_parallel_data threat_parallel; // Threads the simulation thread relaxes large threat regions on (started with the game)
+    snapshot_buffer_data snapshots;       // Snapshots for the main thread
+    atomic<long> clock{0};                // Game time, set by the main thread once per frame
+    atomic<long> next_event_time{0};      // Game time of the next mold event, set by the simulation thread after each step
+    atomic<bool> running{false};          // Cleared by the main thread to stop the simulation thread
+    mutex wake_mutex;                     // Guards the simulation thread's check of whether it has anything to do
+    condition_variable wake;              // Signalled when an edit arrives, the clock reaches the next mold event, or the simulation is stopped
+    long published = 0;                   // Number of snapshots published so far (simulation thread only; never reset, so versions stay unique)
+    thread worker;
+};
+
+// Structure to represent how far the molds of a game have got, to tell whether a step changed anything
+struct mold_progress_data
+{
+    int molds;               // Number of molds
+    long spreads;            // Tiles the molds have spread to
+    long states;             // Sum of the molds' states
+    double broken_proportion;
+    double border_proportion;
+    game_state state;
+
+    // Check if the molds have got as far as in the other reading
+    bool same_as(const mold_progress_data &other) const
     {
-        for (int i = 0; i < mold.spreads_count; i++)
-        {
-            if (map.tiles[mold.spread[i].c][mold.spread[i].r].kind == FIX_TILE)
-            {
-                map.tiles[mold.spread[i].c][mold.spread[i].r].kind = BROKEN_TILE;
-            }
-        }
-        mold.state = BROKEN;
+        return molds == other.molds && spreads == other.spreads && states == other.states && broken_proportion == other.broken_proportion &&
+               border_proportion == other.border_proportion && state == other.state;
     }
-}
+};
 
-// Function to initialize the map with normal tiles
-void init_map(map_data &map)
+// Function to get the name of a difficulty
+string difficulty_name(difficulty_level difficulty)
 {
-    for (int i = 0; i < MAX_MAP_COLS; i++)
+    switch (difficulty)
     {
-        for (int j = 0; j < MAX_MAP_ROWS; j++)
-        {
-            map.tiles[i][j].kind = NORMAL_TILE;
-        }
+    case EASY:
+        return "Easy";
+    case MEDIUM:
+        return "Medium";
+    case HARD:
+        return "Hard";
+    default:
+        return "Unrated";
     }
 }
 
-// Function to check if there is space available for mold to spread
-bool is_space_available(map_data &map)
+// Function to get the sidecar index file for a difficulty
+string score_index_file(difficulty_level difficulty)
 {
-    for (int i = 0; i < MAX_MAP_COLS; i++)
+    return "scores-" + difficulty_name(difficulty) + ".idx";
+}
+
+// Function to clamp a score to the range covered by the index
+// Scores from SCORE_INDEX_SIZE - 1 up (over 4.5 hours survived) all land in the last bucket, so the index cannot tell them
+// apart: they tie for rank and come back from lookups as SCORE_INDEX_SIZE - 1, which score_text shows as "16383+".
+int score_bucket(int score)
+{
+    if (score < 0)
+        return 0;
+    if (score >= SCORE_INDEX_SIZE)
+        return SCORE_INDEX_SIZE - 1;
+    return score;
+}
+
+// Function to get the text a score read back from an index is shown with
+string score_text(int score)
+{
+    if (score >= SCORE_INDEX_SIZE - 1)
+        return to_string(SCORE_INDEX_SIZE - 1) + "+";
+    return to_string(score);
+}
+
+// Function to add one score to an index
+void add_to_score_index(score_index_data &index, int score)
+{
+    for (int i = score_bucket(score) + 1; i <= SCORE_INDEX_SIZE; i += i & -i)
     {
-        for (int j = 0; j < MAX_MAP_ROWS; j++)
-        {
-            if (map.tiles[i][j].kind == NORMAL_TILE)
-            {
-                return true;
-            }
-        }
+        index.tree[i]++;
     }
-    return false;
+    index.total++;
 }
 
-// Function to update the game's broken and border tile proportions
-void update_game(game_data &game, const map_data &map)
+// Function to count the scores in an index that are less than or equal to a score
+int count_scores_up_to(const score_index_data &index, int score)
 {
-    int broken_tiles = 0;
-    int border_tiles = 0;
+    int count = 0;
+    for (int i = score_bucket(score) + 1; i > 0; i -= i & -i)
+    {
+        count += index.tree[i];
+    }
+    return count;
+}
 
-    for (int i = 0; i < MAX_MAP_COLS; i++)
+// Function to find the smallest score with at least `position` scores up to it (1-based, ascending)
+int find_score_at(const score_index_data &index, int position)
+{
+    int i = 0;
+    for (int step = SCORE_INDEX_SIZE; step > 0; step /= 2)
     {
-        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        if (i + step <= SCORE_INDEX_SIZE && index.tree[i + step] < position)
         {
-            if (map.tiles[i][j].kind == BROKEN_TILE)
-            {
-                broken_tiles++;
-            }
-            else if (map.tiles[i][j].kind == BORDER_TILE)
-            {
-                border_tiles++;
-            }
+            i += step;
+            position -= index.tree[i];
         }
     }
-
-    game.broken_proportion = static_cast<double>(broken_tiles) * 100 / (MAX_MAP_COLS * MAX_MAP_ROWS);
-    game.border_proportion = static_cast<double>(border_tiles) * 100 / (MAX_MAP_COLS * MAX_MAP_ROWS);
+    return i; // Tree entry i + 1 holds score i
 }
 
-// Function to initialize the explorer data
-void init_explorer(explorer_data &explorer)
+// Function to reset an index to empty
+void reset_score_index(score_index_data &index, difficulty_level difficulty)
 {
-    init_map(explorer.map);
-    explorer.editor_tile_kind = NORMAL_TILE;
-    explorer.camera = point_at(0, 0);
+    index.difficulty = difficulty;
+    index.records_covered = 0;
+    index.total = 0;
+    index.tree.assign(SCORE_INDEX_SIZE + 1, 0);
 }
 
-// Function to get the color corresponding to a tile kind
-color color_for_tile_kind(tile_kind kind)
+// Function to count the records in the score log
+long count_score_log_records()
 {
-    switch (kind)
+    ifstream log_file(SCORE_FILE, ios::binary | ios::ate);
+    if (!log_file.is_open())
     {
-    case NORMAL_TILE:
-        return color_burly_wood();
-    case MOLDY_TILE:
-        return color_dark_olive_green();
-    case FIX_TILE:
-        return color_yellow_green();
-    case BROKEN_TILE:
-        return color_gray();
-    case BORDER_TILE:
-        return color_black();
-    default:
-        return color_white();
+        return 0;
     }
+    return static_cast<long>(log_file.tellg()) / sizeof(score_record);
 }
 
-// Function to draw a single tile at a specific position
-void draw_tile(tile_data tile, int x, int y)
+// Function to add the log records written since the index was last updated
+bool catch_up_score_index(score_index_data &index)
 {
-    fill_rectangle(color_for_tile_kind(tile.kind), x, y, TILE_WIDTH, TILE_HEIGHT);
+    ifstream log_file(SCORE_FILE, ios::binary);
+    if (!log_file.is_open())
+    {
+        return false;
+    }
+
+    log_file.seekg(index.records_covered * sizeof(score_record));
+
+    bool changed = false;
+    score_record record;
+    while (log_file.read(reinterpret_cast<char *>(&record), sizeof(score_record)))
+    {
+        if (record.difficulty == index.difficulty)
+        {
+            add_to_score_index(index, record.score);
+        }
+        index.records_covered++;
+        changed = true;
+    }
+    return changed;
 }
 
-// Function to determine whether a mold is off the visible map
-attention_data mold_visibility(int mold_start_c, int mold_start_r, const point_2d &camera)
+// Function to write an index to its sidecar file (written to a temporary file, then renamed over the old one)
+void save_score_index(const score_index_data &index)
 {
-    attention_data attention;
-
-    // Calculate the visible range of columns and rows
-    int map_start_c = camera.x / TILE_WIDTH;
-    int map_end_c = (camera.x + screen_width()) / TILE_WIDTH;
-    int map_start_r = camera.y / TILE_HEIGHT;
-    int map_end_r = (camera.y + screen_height()) / TILE_HEIGHT;
+    string file_name = score_index_file(index.difficulty);
+    string temp_name = file_name + "." + to_string(rnd(0, 1000000)) + ".tmp";
 
-    // Determine the relative position of the mold
-    if (mold_start_c < map_start_c)
+    ofstream index_file(temp_name, ios::binary | ios::trunc);
+    if (!index_file.is_open())
     {
-        attention.visibility = "Left";
-        attention.new_r = mold_start_r - map_start_r;
+        write_line("Failed to open " + temp_name + " for writing.");
+        return;
+    }
 
-        // Ensure the new row is within bounds
-        if (attention.new_r < 0)
-            attention.new_r = 0;
-        else if (attention.new_r >= WINDOW_HEIGHT / TILE_HEIGHT)
-            attention.new_r = WINDOW_HEIGHT / TILE_HEIGHT - 1;
+    int64_t records_covered = index.records_covered;
+    int32_t total = index.total;
+    index_file.write(reinterpret_cast<const char *>(&SCORE_INDEX_MAGIC), sizeof(SCORE_INDEX_MAGIC));
+    index_file.write(reinterpret_cast<const char *>(&records_covered), sizeof(records_covered));
+    index_file.write(reinterpret_cast<const char *>(&total), sizeof(total));
+    index_file.write(reinterpret_cast<const char *>(index.tree.data()), index.tree.size() * sizeof(int));
+    index_file.close();
+
+    // Replace the old index in one step, so other games never find it missing (rename will not replace a file on Windows)
+#ifdef _WIN32
+    bool is_replaced = MoveFileExA(temp_name.c_str(), file_name.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+    bool is_replaced = rename(temp_name.c_str(), file_name.c_str()) == 0;
+#endif
+    if (!is_replaced)
+    {
+        remove(temp_name.c_str());
     }
+}
 
-    else if (mold_start_c > map_end_c)
+// Function to load an index from its sidecar file, rebuilding it from the log if it is missing or damaged
+void load_score_index(score_index_data &index, difficulty_level difficulty)
+{
+    reset_score_index(index, difficulty);
+
+    ifstream index_file(score_index_file(difficulty), ios::binary);
+    if (index_file.is_open())
     {
-        attention.visibility = "Right";
-        attention.new_r = mold_start_r - map_start_r;
+        uint32_t magic = 0;
+        int64_t records_covered = 0;
+        int32_t total = 0;
+        index_file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        index_file.read(reinterpret_cast<char *>(&records_covered), sizeof(records_covered));
+        index_file.read(reinterpret_cast<char *>(&total), sizeof(total));
+        index_file.read(reinterpret_cast<char *>(index.tree.data()), index.tree.size() * sizeof(int));
+
+        if (index_file && magic == SCORE_INDEX_MAGIC && records_covered <= count_score_log_records())
+        {
+            index.records_covered = records_covered;
+            index.total = total;
+        }
+        else
+        {
+            reset_score_index(index, difficulty);
+        }
+        index_file.close();
+    }
 
-        // Ensure the new row is within bounds
-        if (attention.new_r < 0)
-            attention.new_r = 0;
-        else if (attention.new_r >= WINDOW_HEIGHT / TILE_HEIGHT)
-            attention.new_r = WINDOW_HEIGHT / TILE_HEIGHT - 1;
+    if (catch_up_score_index(index))
+    {
+        save_score_index(index);
     }
+}
 
-    else if (mold_start_r < map_start_r)
+// Function to append one record to the score log
+// The record goes out in a single write to a file opened for appending only (O_APPEND on POSIX systems, FILE_APPEND_DATA
+// on Windows), which the OS performs as one atomic append, so games saving at the same moment never interleave or
+// overwrite records (on local file systems).
+bool append_score_record(int score, difficulty_level difficulty, int64_t timestamp)
+{
+    score_record record;
+    record.score = score;
+    record.difficulty = difficulty;
+    record.timestamp = timestamp;
+
+#ifndef _WIN32
+    int log_fd = ::open(SCORE_FILE.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (log_fd < 0)
+    {
+        return false;
+    }
+    ssize_t written = ::write(log_fd, &record, sizeof(score_record));
+    ::close(log_fd);
+    return written == sizeof(score_record);
+#else
+    HANDLE log_file = CreateFileA(SCORE_FILE.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (log_file == INVALID_HANDLE_VALUE)
     {
-        attention.visibility = "Top";
-        attention.new_c = mold_start_c - map_start_c;
+        return false;
+    }
+    DWORD written = 0;
+    BOOL is_written = WriteFile(log_file, &record, sizeof(score_record), &written, nullptr);
+    CloseHandle(log_file);
+    return is_written && written == sizeof(score_record);
+#endif
+}
 
-        // Ensure the new column is within bounds
-        if (attention.new_c < 0)
-            attention.new_c = 0;
-        else if (attention.new_c >= WINDOW_WIDTH / TILE_WIDTH)
-            attention.new_c = WINDOW_WIDTH / TILE_WIDTH - 1;
+// Function to import the plain text scores from older versions into the score log
+// Games starting at the same time race to create the marker file exclusively; only the one that creates it imports,
+// and once it exists no game imports again.
+void import_legacy_scores()
+{
+    ifstream log_file(SCORE_FILE, ios::binary);
+    if (log_file.is_open())
+    {
+        return; // Imported by an older version, or new scores exist
     }
 
-    else if (mold_start_r > map_end_r)
+    ifstream legacy_file(LEGACY_SCORE_FILE);
+    if (!legacy_file.is_open())
     {
-        attention.visibility = "Bottom";
-        attention.new_c = mold_start_c - map_start_c;
+        return;
+    }
 
-        // Ensure the new column is within bounds
-        if (attention.new_c < 0)
-            attention.new_c = 0;
-        else if (attention.new_c >= WINDOW_WIDTH / TILE_WIDTH)
-            attention.new_c = WINDOW_WIDTH / TILE_WIDTH - 1;
+    FILE *marker = fopen(LEGACY_IMPORT_MARKER.c_str(), "wx");
+    if (marker == nullptr)
+    {
+        return; // Another game is importing or has imported the scores
     }
+    fclose(marker);
 
-    else
+    int score;
+    while (legacy_file >> score)
     {
-        attention.visibility = "Visible";
+        append_score_record(score, UNRATED, 0);
     }
+    legacy_file.close();
+}
 
-    return attention;
+// Function to initialize the score store
+void init_score_store(score_store_data &store)
+{
+    import_legacy_scores();
+
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
+    {
+        load_score_index(store.indexes[i], static_cast<difficulty_level>(i));
+    }
 }
 
-// Function to draw the entire map based on the camera position
-void draw_map(const map_data &map, const point_2d &camera)
+// Function to pick up scores appended by this or any other game instance
+void refresh_score_store(score_store_data &store)
 {
-    int start_col = camera.x / TILE_WIDTH;
-    int end_col = (camera.x + screen_width()) / TILE_WIDTH + 1;
-    int start_row = camera.y / TILE_HEIGHT;
-    int end_row = (camera.y + screen_height()) / TILE_HEIGHT + 1;
+    TRACK_ALLOCATIONS("refresh_score_store");
 
-    if (start_col < 0)
-        start_col = 0;
-    if (start_row < 0)
-        start_row = 0;
+    long log_records = count_score_log_records();
 
-    for (int c = start_col; c < end_col && c < MAX_MAP_COLS; c++)
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
     {
-        for (int r = start_row; r < end_row && r < MAX_MAP_ROWS; r++)
+        if (store.indexes[i].records_covered < log_records && catch_up_score_index(store.indexes[i]))
         {
-            draw_tile(map.tiles[c][r], c * TILE_WIDTH, r * TILE_HEIGHT);
+            save_score_index(store.indexes[i]);
         }
     }
 }
 
-// Frunction to draw the prepare game interface
-void prepare_interface(game_data &game)
+// Function to get the rank of a score among the scores of its difficulty (1 is the best)
+int get_score_rank(const score_index_data &index, int score)
 {
-    clear_screen(color_yellow_green());
-
-    set_camera_position(point_at(0, 0));
-
-    draw_bitmap(MOLD_PIC, (WINDOW_WIDTH - 200) / 2, 0);
-
-    draw_text("Welcome to Moldbound!", color_dark_olive_green(), "Text Font", 50, 120, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT * 3 - 50 + 50);
+    return index.total - count_scores_up_to(index, score) + 1;
+}
 
-    if (button("Start Game: Easy", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT * 2 + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+// Function to get the top scores of one difficulty in descending order
+vector<int> get_top_scores(const score_index_data &index, int k)
+{
+    vector<int> scores;
+    for (int i = 0; i < k && i < index.total; i++)
     {
-        game.mold_appearance_time = 10000;
-        game.state = PLAYING;
-        reset_timer(GAME_TIMER);
-        start_timer(GAME_TIMER);
+        scores.push_back(find_score_at(index, index.total - i));
     }
-    if (button("Start Game: Medium", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    return scores;
+}
+
+// Function to save the score to the score log and work out its rank
+bool save_score_to_file(game_data &game, score_store_data &store)
+{
+    TRACK_ALLOCATIONS("save_score_to_file");
+
+    if (append_score_record(game.score, game.difficulty, time(nullptr)))
     {
-        game.mold_appearance_time = 8000;
-        game.state = PLAYING;
-        reset_timer(GAME_TIMER);
-        start_timer(GAME_TIMER);
+        write_line("Score saved to " + SCORE_FILE);
+
+        refresh_score_store(store);
+        const score_index_data &index = store.indexes[game.difficulty];
+        game.rank = get_score_rank(index, game.score);
+        game.top_percent = index.total > 0 ? 100.0 * game.rank / index.total : 100.0;
+        return true;
     }
-    if (button("Start Game: Hard", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    else
     {
-        game.mold_appearance_time = 5000;
-        game.state = PLAYING;
-        reset_timer(GAME_TIMER);
-        start_timer(GAME_TIMER);
+        write_line("Failed to open " + SCORE_FILE + " for writing.");
+        return false;
     }
+}
 
-    if (button("Exit Program", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+// Function to get the top 5 highest scores across all difficulties
+vector<int> get_top_5_scores(const score_store_data &store)
+{
+    vector<int> scores;
+
+    // Each index gives its own top 5, and the overall top 5 is among them
+    for (int i = 0; i < DIFFICULTY_COUNT; i++)
     {
-        game.state = QUIT;
+        vector<int> top = get_top_scores(store.indexes[i], 5);
+        scores.insert(scores.end(), top.begin(), top.end());
     }
 
-    // Display the top 5 scores
-    vector<int> top_scores = get_top_5_scores();
-    for (int i = 0; i < top_scores.size(); i++)
+    // Sort the scores in descending order
+    sort(scores.begin(), scores.end(), greater<int>());
+
+    // Get the top 5 scores
+    if (scores.size() > 5)
     {
-        draw_text(to_string(i + 1) + ". " + to_string(top_scores[i]), color_black(), "Text Font", 20, (WINDOW_WIDTH - BUTTON_WIDTH) / 2 + 50, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT + LINE_SPACING + LINE_SPACING * (i + 1) + 50);
+        scores.resize(5);
     }
+
+    return scores;
 }
 
-// Function to draw the attention icon for molds that are off the visible map
-void draw_attention_icon(game_data &game, const explorer_data &explorer)
+// Function to initialize a location
+location_data init_loc(int c, int r)
 {
-    if (!game.molds.v.empty())
-    {
-        for (int i = 0; i < game.molds.v.size(); i++)
-        {
-
-            // Draw the attention icon for spreading molds that are off the visible map
-            if (game.molds.v[i].state == SPREADING)
-            {
-                attention_data attention = mold_visibility(game.molds.v[i].start_loc.c, game.molds.v[i].start_loc.r, explorer.camera);
-                if (attention.visibility == "Left")
-                {
-                    draw_bitmap(ATTENTION_ICON, explorer.camera.x, explorer.camera.y + attention.new_r * TILE_HEIGHT);
-                }
-                else if (attention.visibility == "Right")
-                {
-                    draw_bitmap(ATTENTION_ICON, explorer.camera.x + WINDOW_WIDTH - TILE_WIDTH, explorer.camera.y + attention.new_r * TILE_HEIGHT);
-                }
-                else if (attention.visibility == "Top")
-                {
-                    draw_bitmap(ATTENTION_ICON, explorer.camera.x + attention.new_c * TILE_WIDTH, explorer.camera.y);
-                }
-                else if (attention.visibility == "Bottom")
-                {
-                    draw_bitmap(ATTENTION_ICON, explorer.camera.x + attention.new_c * TILE_WIDTH, explorer.camera.y + WINDOW_HEIGHT - TILE_HEIGHT);
-                }
-            }
-        }
-    }
+    location_data loc;
+    loc.c = c;
+    loc.r = r;
+    return loc;
 }
 
-// Function to draw the playing interface
-void playing_interface(const explorer_data &explorer, game_data &game)
+// Function to initialize a mold where it already lives (its frontier keeps the capacity it has grown to)
+void init_mold_in_place(mold_data &mold, int start_c, int start_r, uint8_t id, long current_time)
 {
-    set_camera_position(explorer.camera);
+    mold.start_loc = init_loc(start_c, start_r); // Initialize starting location
+    mold.id = id;                                // Initialize ID
 
-    clear_screen(color_white());
+    mold.state = PREPARE; // Initialize state
 
-    draw_map(explorer.map, explorer.camera);
+    mold.appear_at_time = current_time; // Set appearance time
+    mold.last_spread_time = 0;          // Initialize last spread time
+    mold.time_to_start_fix = 0;         // Initialize time to start fix
 
-    draw_attention_icon(game, explorer);
+    mold.spreads_count = 0;
+    mold.model = BFS_SPREAD;
 
-    // Draw the editor to change tile kind
-    draw_text("Editor: Enter 1 for BORDER_TILE, 2 for NORMAL_TILE", color_sea_green(), "Text Font", 15, explorer.camera.x, explorer.camera.y);
-    draw_rectangle(color_black(), explorer.camera.x, explorer.camera.y + 10 + LINE_SPACING, 50, 50);
-    fill_rectangle(color_for_tile_kind(explorer.editor_tile_kind), explorer.camera.x + 10, explorer.camera.y + 20 + LINE_SPACING, 30, 30);
-    draw_rectangle(color_black(), explorer.camera.x + 10, explorer.camera.y + LINE_SPACING * 2, 30, 30);
+    // Initialize the frontier
+    mold.q.clear();
+}
 
-    draw_text("Percentage of map unavailable: " + to_string(game.broken_proportion + game.border_proportion) + "%", color_sea_green(), "Text Font", 15, explorer.camera.x, explorer.camera.y + 10 + LINE_SPACING * 4);
+// Function to initialize the mold
+mold_data init_mold(int start_c, int start_r, uint8_t id, long current_time)
+{
+    mold_data mold;
+    init_mold_in_place(mold, start_c, start_r, id, current_time);
+    return mold;
+}
 
-    if (button("Pause Game", rectangle_from(WINDOW_WIDTH - BUTTON_WIDTH, 0, BUTTON_WIDTH, BUTTON_HEIGHT)))
+// Function to initialize the molds data
+molds_data init_molds()
+{
+    molds_data molds;
+    molds.time_to_appear_next = 0;
+    molds.last_id = 0;
+    return molds;
+}
+
+// Function to find a mold ID that no current mold uses (0 if every ID is taken)
+uint8_t next_free_mold_id(molds_data &molds)
+{
+    for (int tries = 0; tries < MAX_MOLD_IDS - 1; tries++)
     {
-        game.state = PAUSING;
-        pause_timer(GAME_TIMER);
+        molds.last_id = molds.last_id % (MAX_MOLD_IDS - 1) + 1;
+
+        bool in_use = false;
+        for (int i = 0; i < molds.v.size() && !in_use; i++)
+        {
+            in_use = molds.v[i].id == molds.last_id;
+        }
+        if (!in_use)
+        {
+            return molds.last_id;
+        }
     }
+    return 0;
 }
 
-// Function to draw the pausing interface
-void pausing_interface(game_data &game)
+// Function to initialize the game data
+game_data init_game()
 {
-    if (button("Resume Game", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    game_data game;
+    game.broken_proportion = 0.0;
+    game.border_proportion = 0.0;
+    game.molds = init_molds();
+    game.mold_appearance_time = 0;
+    game.state = PREPARE_GAME;
+    game.difficulty = EASY;
+    game.model = BFS_SPREAD;
+    game.stochastic.seed = 0;
+    game.stochastic.last_tick = -1;
+    game.score = 0;
+    game.is_player_score_saved = false;
+    game.rank = 0;
+    game.top_percent = 0.0;
+    return game;
+}
+
+// Function to initialize the game effect data
+game_effect_data init_game_effect()
+{
+    game_effect_data game_effect;
+    game_effect.is_sound_on = true;
+    return game_effect;
+}
+
+// Function to initialize the threat heat-map with no frontiers
+void init_threat(threat_data &threat)
+{
+    for (int i = 0; i < MAX_MAP_COLS; i++)
     {
-        game.state = PLAYING;
-        resume_timer(GAME_TIMER);
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            threat.dist[i][j] = THREAT_UNREACHABLE;
+            threat.is_source[i][j] = false;
+        }
+    }
+    threat.parallel = nullptr;
+}
+
+// Function to start the threads and scratch space for parallel threat relaxes
+void init_threat_parallel(threat_parallel_data &parallel, int threads)
+{
+    flood_fill::init_thread_pool(parallel.pool, threads);
+    parallel.claimed = vector<atomic<uint64_t>>((MAX_MAP_COLS * MAX_MAP_ROWS + 63) / 64);
+    parallel.local_next.resize(parallel.pool.size);
+    parallel.offsets.resize(parallel.pool.size);
+    parallel.frontier_size = 0;
+    parallel.next_chunk.store(0);
+}
+
+// Function to propagate shorter threat distances outward from the pending tiles
+void relax_threat(const map_data &map, threat_data &threat)
+{
+    for (int p = 0; p < threat.pending.size(); p++)
+    {
+        int c = threat.pending[p].first;
+        int r = threat.pending[p].second;
+
+        for (int i = 0; i < 8; i++)
+        {
+            int nc = c + DY[i];
+            int nr = r + DX[i];
+            if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+            {
+                // Mold only ever reaches normal tiles, so the distance only flows through them
+                if (map.tiles[nc][nr].kind == NORMAL_TILE && threat.dist[nc][nr] > threat.dist[c][r] + 1)
+                {
+                    threat.dist[nc][nr] = threat.dist[c][r] + 1;
+                    threat.pending.push_back({nc, nr});
+                }
+            }
+        }
+    }
+    threat.pending.clear();
+}
+
+// Function to add the pending tiles at the given distance to the frontier, after its first size tiles (returns the new size)
+// The pending tiles are sorted by distance, and next_seed is the first one not taken yet.
+size_t take_threat_seeds(threat_data &threat, size_t &next_seed, int level, size_t size)
+{
+    threat_parallel_data &parallel = *threat.parallel;
+    if (parallel.frontier.size() < size + threat.pending.size() - next_seed)
+        parallel.frontier.resize(size + threat.pending.size() - next_seed);
+
+    while (next_seed < threat.pending.size() && threat.dist[threat.pending[next_seed].first][threat.pending[next_seed].second] <= level)
+    {
+        int c = threat.pending[next_seed].first;
+        int r = threat.pending[next_seed].second;
+        if (threat.dist[c][r] == level)
+            parallel.frontier[size++] = static_cast<uint32_t>(c * MAX_MAP_ROWS + r);
+        next_seed++;
+    }
+    return size;
+}
+
+// Function to propagate shorter threat distances outward from the pending tiles on the thread pool (same distances as relax_threat)
+// Tiles are lowered one distance at a time: every thread expands chunks of the current level, claiming each lowered tile once,
+// and the distances are only written between levels, so threads never race on them.
+void relax_threat_parallel(const map_data &map, threat_data &threat)
+{
+    threat_parallel_data &parallel = *threat.parallel;
+    flood_fill::thread_pool_data &pool = parallel.pool;
+
+    sort(threat.pending.begin(), threat.pending.end(), [&](const pair<int, int> &a, const pair<int, int> &b)
+         { return threat.dist[a.first][a.second] < threat.dist[b.first][b.second]; });
+
+    size_t next_seed = 0;
+    int level = threat.pending.empty() ? 0 : threat.dist[threat.pending[0].first][threat.pending[0].second];
+    parallel.frontier_size = take_threat_seeds(threat, next_seed, level, 0);
+    parallel.next_chunk.store(0, memory_order_relaxed);
+
+    flood_fill::run_on_pool(pool, [&](int index)
+                            {
+        vector<uint32_t> &next = parallel.local_next[index];
+
+        while (parallel.frontier_size > 0)
+        {
+            // Lower the normal neighbors of the current level to the next distance
+            size_t start;
+            while ((start = parallel.next_chunk.fetch_add(THREAT_CHUNK_SIZE, memory_order_relaxed)) < parallel.frontier_size)
+            {
+                size_t end = min(start + THREAT_CHUNK_SIZE, parallel.frontier_size);
+                for (size_t i = start; i < end; i++)
+                {
+                    int c = parallel.frontier[i] / MAX_MAP_ROWS;
+                    int r = parallel.frontier[i] % MAX_MAP_ROWS;
+                    for (int j = 0; j < 8; j++)
+                    {
+                        int nc = c + DY[j];
+                        int nr = r + DX[j];
+                        if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS && map.tiles[nc][nr].kind == NORMAL_TILE && threat.dist[nc][nr] > level + 1)
+                        {
+                            uint32_t cell = static_cast<uint32_t>(nc * MAX_MAP_ROWS + nr);
+                            uint64_t bit = 1ULL << (cell & 63);
+                            if (!(parallel.claimed[cell >> 6].fetch_or(bit, memory_order_relaxed) & bit))
+                                next.push_back(cell);
+                        }
+                    }
+                }
+            }
+            flood_fill::pool_barrier(pool);
+
+            // One thread lays out the next level: the lowered tiles, then the pending tiles already at that distance
+            if (index == 0)
+            {
+                size_t next_size = 0;
+                for (int i = 0; i < pool.size; i++)
+                {
+                    parallel.offsets[i] = next_size;
+                    next_size += parallel.local_next[i].size();
+                }
+                level++;
+
+                // Skip straight to the next pending tile when nothing was lowered
+                if (next_size == 0 && next_seed < threat.pending.size())
+                    level = max(level, threat.dist[threat.pending[next_seed].first][threat.pending[next_seed].second]);
+                parallel.frontier_size = take_threat_seeds(threat, next_seed, level, next_size);
+                parallel.next_chunk.store(0, memory_order_relaxed);
+            }
+            flood_fill::pool_barrier(pool);
+
+            for (size_t i = 0; i < next.size(); i++)
+            {
+                uint32_t cell = next[i];
+                threat.dist[cell / MAX_MAP_ROWS][cell % MAX_MAP_ROWS] = level;
+                parallel.claimed[cell >> 6].fetch_and(~(1ULL << (cell & 63)), memory_order_relaxed);
+            }
+            copy(next.begin(), next.end(), parallel.frontier.begin() + parallel.offsets[index]);
+            next.clear();
+            flood_fill::pool_barrier(pool);
+        } });
+
+    threat.pending.clear();
+}
+
+// Function to mark a tile as part of a mold's frontier
+void add_threat_source(const map_data &map, threat_data &threat, int c, int r)
+{
+    TRACK_ALLOCATIONS("add_threat_source");
+
+    threat.is_source[c][r] = true;
+    threat.dist[c][r] = 0;
+    threat.pending.push_back({c, r});
+
+    relax_threat(map, threat);
+}
+
+// Function to update the threat heat-map when a tile becomes a normal tile again
+void open_threat_tile(const map_data &map, threat_data &threat, int c, int r)
+{
+    TRACK_ALLOCATIONS("open_threat_tile");
+
+    // Take the best distance offered by any neighbor
+    for (int i = 0; i < 8; i++)
+    {
+        int nc = c + DY[i];
+        int nr = r + DX[i];
+        if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+        {
+            if ((threat.is_source[nc][nr] || map.tiles[nc][nr].kind == NORMAL_TILE) && threat.dist[nc][nr] + 1 < threat.dist[c][r])
+            {
+                threat.dist[c][r] = threat.dist[nc][nr] + 1;
+            }
+        }
+    }
+
+    if (threat.dist[c][r] < THREAT_UNREACHABLE)
+    {
+        threat.pending.push_back({c, r});
+        relax_threat(map, threat);
+    }
+}
+
+// Function to update the threat heat-map when a tile stops carrying distance (blocked or no longer a frontier)
+void close_threat_tile(const map_data &map, threat_data &threat, int c, int r)
+{
+    TRACK_ALLOCATIONS("close_threat_tile");
+
+    threat.invalid.push_back({c, r});
+    threat.invalid_dist.push_back(threat.dist[c][r]);
+    threat.region.push_back({c, r});
+    threat.dist[c][r] = THREAT_UNREACHABLE;
+    threat.is_source[c][r] = false;
+
+    // Reset every tile on a chain of increasing distance starting at the closed tile
+    for (int k = 0; k < threat.invalid.size(); k++)
+    {
+        int ic = threat.invalid[k].first;
+        int ir = threat.invalid[k].second;
+        int old_dist = threat.invalid_dist[k];
+
+        if (old_dist >= THREAT_UNREACHABLE)
+            continue;
+
+        for (int i = 0; i < 8; i++)
+        {
+            int nc = ic + DY[i];
+            int nr = ir + DX[i];
+            if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+            {
+                if (map.tiles[nc][nr].kind == NORMAL_TILE && !threat.is_source[nc][nr] && threat.dist[nc][nr] == old_dist + 1)
+                {
+                    threat.invalid.push_back({nc, nr});
+                    threat.invalid_dist.push_back(threat.dist[nc][nr]);
+                    threat.region.push_back({nc, nr});
+                    threat.dist[nc][nr] = THREAT_UNREACHABLE;
+                }
+            }
+        }
+    }
+
+    threat.invalid.clear();
+    threat.invalid_dist.clear();
+
+    // Refill the reset region from its still valid neighbors
+    for (int i = 0; i < threat.region.size(); i++)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            int nc = threat.region[i].first + DY[j];
+            int nr = threat.region[i].second + DX[j];
+            if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+            {
+                if ((threat.is_source[nc][nr] || map.tiles[nc][nr].kind == NORMAL_TILE) && threat.dist[nc][nr] < THREAT_UNREACHABLE)
+                {
+                    threat.pending.push_back({nc, nr});
+                }
+            }
+        }
+    }
+    size_t region_size = threat.region.size();
+    threat.region.clear();
+
+    if (threat.parallel != nullptr && threat.parallel->pool.size > 1 && region_size >= THREAT_PARALLEL_MIN_REGION)
+    {
+        relax_threat_parallel(map, threat);
+    }
+    else
+    {
+        relax_threat(map, threat);
+    }
+
+    // A blocked tile carries no distance of its own
+    if (map.tiles[c][r].kind != NORMAL_TILE)
+    {
+        threat.dist[c][r] = THREAT_UNREACHABLE;
+    }
+}
+
+// Function to change the kind of a tile, keeping the block counts of every level of detail up to date
+void set_tile_kind(map_data &map, int c, int r, tile_kind kind)
+{
+    tile_kind old_kind = map.tiles[c][r].kind;
+    for (int level = 0; level < LOD_LEVELS; level++)
+    {
+        uint8_t *counts = map.lod_counts[level][c / LOD_BLOCK_SIZES[level]][r / LOD_BLOCK_SIZES[level]];
+        counts[old_kind]--;
+        counts[kind]++;
+    }
+    map.tiles[c][r].kind = kind;
+}
+
+// Function to give a tile to a mold, adding it to the end of the mold's live list
+void add_live_tile(map_data &map, uint8_t id, int c, int r)
+{
+    map.owner[c][r] = id;
+    map.live_slot[c][r] = static_cast<frontier_index>(map.live_tiles[id].size());
+    map.live_tiles[id].push_back(static_cast<frontier_index>(c * MAX_MAP_ROWS + r));
+}
+
+// Function to take a tile from the mold that owns it, moving the last tile of the mold's live list into its slot
+void remove_live_tile(map_data &map, int c, int r)
+{
+    vector<frontier_index> &live = map.live_tiles[map.owner[c][r]];
+    frontier_index slot = map.live_slot[c][r];
+    frontier_index last = live.back();
+    live[slot] = last;
+    map.live_slot[last / MAX_MAP_ROWS][last % MAX_MAP_ROWS] = slot;
+    live.pop_back();
+    map.owner[c][r] = 0;
+}
+
+// Function to spread mold to neighboring tiles
+void spread_mold(map_data &map, mold_data &mold, threat_data &threat, long current_time)
+{
+    TRACK_ALLOCATIONS("spread_mold");
+
+    int c = mold.q.front_c();
+    int r = mold.q.front_r();
+    mold.q.pop();
+
+    // Check current spot's 8-connected neighbors
+    for (int i = 0; i < 8; i++)
+    {
+        int nc = c + DY[i];
+        int nr = r + DX[i];
+        if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS)
+        {
+            // Spread the mold to the neighbor if it's a normal tile
+            if (map.tiles[nc][nr].kind == NORMAL_TILE)
+            {
+                mold.spreads_count++;
+                set_tile_kind(map, nc, nr, MOLDY_TILE);
+                add_live_tile(map, mold.id, nc, nr);
+                mold.q.push(nc, nr);
+                mold.last_spread_time = current_time;
+                add_threat_source(map, threat, nc, nr);
+            }
+        }
+    }
+
+    // The popped tile has spread all it can and leaves the frontier
+    close_threat_tile(map, threat, c, r);
+
+    // Check if the queue is empty, indicating that mold has finished spreading
+    if (mold.q.empty())
+    {
+        mold.time_to_start_fix = current_time + MOLD_FIX_TIME; // Set time to start fix
+        mold.state = DONE_SPREADING;
+    }
+}
+
+// Function to handle the lifecycle of mold (appearance, spreading, fixing, breaking)
+void handle_mold_lifecycle(map_data &map, mold_data &mold, threat_data &threat, long current_time)
+{
+    TRACK_ALLOCATIONS("handle_mold_lifecycle");
+
+    // A mold whose starting tile was taken before it appeared never appears
+    if (mold.state == PREPARE && map.tiles[mold.start_loc.c][mold.start_loc.r].kind != NORMAL_TILE)
+    {
+        mold.state = BROKEN;
+    }
+
+    // Push the mold's starting position into the queue
+    if (mold.state == PREPARE)
+    {
+        mold.q.push(mold.start_loc.c, mold.start_loc.r);
+        mold.spreads_count++;
+        set_tile_kind(map, mold.start_loc.c, mold.start_loc.r, MOLDY_TILE);
+        add_live_tile(map, mold.id, mold.start_loc.c, mold.start_loc.r);
+        add_threat_source(map, threat, mold.start_loc.c, mold.start_loc.r);
+        mold.last_spread_time = current_time;
+        mold.state = SPREADING;
+    }
+
+    // Spread the mold (molds on the stochastic model are spread together by spread_molds_stochastic)
+    if (mold.state == SPREADING && mold.model == BFS_SPREAD && mold.is_time_to_spread(current_time))
+    {
+        spread_mold(map, mold, threat, current_time);
+    }
+
+    // Change the mold's spread tiles to FIX_TILE when done spreading (the player cannot repair a tile before this, so all are still live)
+    vector<frontier_index> &live = map.live_tiles[mold.id];
+    if (mold.state == DONE_SPREADING)
+    {
+        for (size_t i = 0; i < live.size(); i++)
+        {
+            set_tile_kind(map, live[i] / MAX_MAP_ROWS, live[i] % MAX_MAP_ROWS, FIX_TILE);
+        }
+        mold.state = FIXING;
+    }
+
+    // The mold is done as soon as the player has fixed every one of its tiles
+    if (mold.state == FIXING && live.empty())
+    {
+        mold.state = BROKEN;
+    }
+
+    // Change the mold's remaining FIX_TILE to BROKEN_TILE after it's past the time to fix (repaired tiles already left the live list)
+    if (mold.state == FIXING && current_time > mold.time_to_start_fix)
+    {
+        for (size_t i = 0; i < live.size(); i++)
+        {
+            int c = live[i] / MAX_MAP_ROWS;
+            int r = live[i] % MAX_MAP_ROWS;
+            set_tile_kind(map, c, r, BROKEN_TILE);
+            map.owner[c][r] = 0;
+        }
+        live.clear();
+        mold.state = BROKEN;
+    }
+}
+
+// Function to draw a random word from a counter (Philox4x32-10: the same seed, tick and tile always give the same word, whatever order tiles are drawn in)
+uint32_t philox_random(uint64_t seed, uint32_t tick, uint32_t tile)
+{
+    uint32_t c0 = tile, c1 = tick, c2 = 0, c3 = 0;
+    uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+
+    for (int i = 0; i < PHILOX_ROUNDS; i++)
+    {
+        uint64_t product0 = static_cast<uint64_t>(PHILOX_M0) * c0;
+        uint64_t product1 = static_cast<uint64_t>(PHILOX_M1) * c2;
+        uint32_t hi0 = product0 >> 32, lo0 = static_cast<uint32_t>(product0);
+        uint32_t hi1 = product1 >> 32, lo1 = static_cast<uint32_t>(product1);
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    return c0;
+}
+
+// Function to start the stochastic spread model for a game
+void init_stochastic_spread(stochastic_spread_data &spread, uint64_t seed, difficulty_level difficulty)
+{
+    spread.seed = seed;
+    spread.last_tick = -1;
+
+    // A tile with k moldy neighbours escapes each of them independently, so it is infected with chance 1 - (1 - p)^k
+    double escape = 1.0;
+    for (int k = 0; k <= 8; k++)
+    {
+        spread.thresholds[k] = static_cast<uint32_t>((1.0 - escape) * 4294967295.0);
+        escape *= 1.0 - STOCHASTIC_SPREAD_CHANCE[difficulty];
+    }
+}
+
+// Function to grow every spreading mold on the stochastic model by one tick, when a new tick has started (returns the number of tiles swept)
+// Each normal tile in the region around the molds is infected with a chance that depends on how many moldy neighbours it has.
+// Every decision is made from the map as it was at the start of the tick and a counter-based random word, so the result does not depend on the order (or the number of threads) the region is swept in.
+long spread_molds_stochastic(map_data &map, molds_data &molds, threat_data &threat, stochastic_spread_data &spread, long current_time)
+{
+    TRACK_ALLOCATIONS("spread_molds_stochastic");
+
+    long tick = current_time / MOLD_SPREAD_TIME;
+    if (tick == spread.last_tick)
+    {
+        return 0;
+    }
+    spread.last_tick = tick;
+
+    // Find the region the spreading molds can reach this tick, and which mold each ID belongs to
+    int mold_index[MAX_MOLD_IDS];
+    bool is_exposed[MAX_MOLD_IDS];
+    int start_c = MAX_MAP_COLS, end_c = -1, start_r = MAX_MAP_ROWS, end_r = -1;
+    for (int i = 0; i < molds.v.size(); i++)
+    {
+        const mold_data &mold = molds.v[i];
+        if (mold.state != SPREADING || mold.model != STOCHASTIC_SPREAD)
+            continue;
+
+        mold_index[mold.id] = i;
+        is_exposed[mold.id] = false;
+        for (int j = 0; j < mold.spreads_count; j++)
+        {
+            start_c = min(start_c, mold.q.cell_c(j));
+            end_c = max(end_c, mold.q.cell_c(j));
+            start_r = min(start_r, mold.q.cell_r(j));
+            end_r = max(end_r, mold.q.cell_r(j));
+        }
+    }
+    if (end_c < 0)
+    {
+        return 0;
+    }
+    start_c = max(start_c - 1, 0);
+    end_c = min(end_c + 1, MAX_MAP_COLS - 1);
+    start_r = max(start_r - 1, 0);
+    end_r = min(end_r + 1, MAX_MAP_ROWS - 1);
+
+    // Column buffers hold one padding row above and below the region, so the neighbour sums need no bounds checks
+    int rows = end_r - start_r + 1;
+    for (int i = 0; i < 3; i++)
+    {
+        spread.moldy[i].assign(rows + 2, 0);
+    }
+    spread.column_sums.assign(rows + 2, 0);
+    spread.neighbours.assign(rows, 0);
+    spread.infections.clear();
+
+    uint8_t *previous = spread.moldy[0].data();
+    uint8_t *current = spread.moldy[1].data();
+    uint8_t *next = spread.moldy[2].data();
+    uint8_t *sums = spread.column_sums.data();
+    uint8_t *neighbours = spread.neighbours.data();
+
+    // The loops over a column below are plain loops over byte arrays, which the compiler vectorises
+    if (start_c > 0)
+    {
+        for (int r = 0; r < rows; r++)
+            previous[r + 1] = map.tiles[start_c - 1][start_r + r].kind == MOLDY_TILE;
+    }
+    for (int r = 0; r < rows; r++)
+        current[r + 1] = map.tiles[start_c][start_r + r].kind == MOLDY_TILE;
+
+    for (int c = start_c; c <= end_c; c++)
+    {
+        if (c + 1 < MAX_MAP_COLS)
+        {
+            for (int r = 0; r < rows; r++)
+                next[r + 1] = map.tiles[c + 1][start_r + r].kind == MOLDY_TILE;
+        }
+        else
+        {
+            fill(next, next + rows + 2, 0);
+        }
+
+        for (int r = 0; r < rows + 2; r++)
+            sums[r] = previous[r] + current[r] + next[r];
+        for (int r = 0; r < rows; r++)
+            neighbours[r] = sums[r] + sums[r + 1] + sums[r + 2] - current[r + 1];
+
+        for (int r = 0; r < rows; r++)
+        {
+            int tile_r = start_r + r;
+            if (neighbours[r] == 0 || map.tiles[c][tile_r].kind != NORMAL_TILE)
+                continue;
+
+            // Every mold next to a normal tile can still grow
+            uint8_t owner = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                int nc = c + DY[i];
+                int nr = tile_r + DX[i];
+                if (nr >= 0 && nr < MAX_MAP_ROWS && nc >= 0 && nc < MAX_MAP_COLS && map.tiles[nc][nr].kind == MOLDY_TILE)
+                {
+                    is_exposed[map.owner[nc][nr]] = true;
+                    if (owner == 0)
+                        owner = map.owner[nc][nr];
+                }
+            }
+
+            uint32_t tile = static_cast<uint32_t>(c * MAX_MAP_ROWS + tile_r);
+            if (philox_random(spread.seed, static_cast<uint32_t>(tick), tile) < spread.thresholds[neighbours[r]])
+            {
+                infection_data infection;
+                infection.c = c;
+                infection.r = tile_r;
+                infection.owner = owner;
+                spread.infections.push_back(infection);
+            }
+        }
+
+        // Move the three-column window one column to the right
+        uint8_t *oldest = previous;
+        previous = current;
+        current = next;
+        next = oldest;
+    }
+
+    // Apply the infections, then relax the threat map from all the new sources at once
+    for (int i = 0; i < spread.infections.size(); i++)
+    {
+        const infection_data &infection = spread.infections[i];
+        mold_data &mold = molds.v[mold_index[infection.owner]];
+
+        set_tile_kind(map, infection.c, infection.r, MOLDY_TILE);
+        add_live_tile(map, infection.owner, infection.c, infection.r);
+        mold.q.push(infection.c, infection.r);
+        mold.spreads_count++;
+
+        threat.is_source[infection.c][infection.r] = true;
+        threat.dist[infection.c][infection.r] = 0;
+        threat.pending.push_back({infection.c, infection.r});
+    }
+    relax_threat(map, threat);
+
+    // Molds with no normal tile left next to them are done spreading
+    for (int i = 0; i < molds.v.size(); i++)
+    {
+        mold_data &mold = molds.v[i];
+        if (mold.state != SPREADING || mold.model != STOCHASTIC_SPREAD)
+            continue;
+
+        mold.last_spread_time = tick * MOLD_SPREAD_TIME;
+        if (!is_exposed[mold.id])
+        {
+            for (int j = 0; j < mold.spreads_count; j++)
+            {
+                if (threat.is_source[mold.q.cell_c(j)][mold.q.cell_r(j)])
+                {
+                    close_threat_tile(map, threat, mold.q.cell_c(j), mold.q.cell_r(j));
+                }
+            }
+            mold.time_to_start_fix = current_time + MOLD_FIX_TIME;
+            mold.state = DONE_SPREADING;
+        }
+    }
+
+    return static_cast<long>(end_c - start_c + 1) * rows;
+}
+
+// Function to initialize the map with normal tiles
+void init_map(map_data &map)
+{
+    for (int i = 0; i < MAX_MAP_COLS; i++)
+    {
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            map.tiles[i][j].kind = NORMAL_TILE;
+            map.owner[i][j] = 0;
+        }
+    }
+
+    // Every block starts with only normal tiles (blocks on the far edges can be cut short by the map)
+    for (int level = 0; level < LOD_LEVELS; level++)
+    {
+        int block = LOD_BLOCK_SIZES[level];
+        for (int i = 0; i < LOD_MAX_BLOCKS; i++)
+        {
+            for (int j = 0; j < LOD_MAX_BLOCKS; j++)
+            {
+                fill(map.lod_counts[level][i][j], map.lod_counts[level][i][j] + TILE_KIND_COUNT, 0);
+                if (i * block < MAX_MAP_COLS && j * block < MAX_MAP_ROWS)
+                {
+                    map.lod_counts[level][i][j][NORMAL_TILE] = min(block, MAX_MAP_COLS - i * block) * min(block, MAX_MAP_ROWS - j * block);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX_MOLD_IDS; i++)
+    {
+        map.live_tiles[i].clear();
+    }
+}
+
+// Function to check if there is space available for mold to spread
+bool is_space_available(map_data &map)
+{
+    for (int i = 0; i < MAX_MAP_COLS; i++)
+    {
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            if (map.tiles[i][j].kind == NORMAL_TILE)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Function to update the game's broken and border tile proportions
+void update_game(game_data &game, const map_data &map)
+{
+    int broken_tiles = 0;
+    int border_tiles = 0;
+
+    for (int i = 0; i < MAX_MAP_COLS; i++)
+    {
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            if (map.tiles[i][j].kind == BROKEN_TILE)
+            {
+                broken_tiles++;
+            }
+            else if (map.tiles[i][j].kind == BORDER_TILE)
+            {
+                border_tiles++;
+            }
+        }
+    }
+
+    game.broken_proportion = static_cast<double>(broken_tiles) * 100 / (MAX_MAP_COLS * MAX_MAP_ROWS);
+    game.border_proportion = static_cast<double>(border_tiles) * 100 / (MAX_MAP_COLS * MAX_MAP_ROWS);
+}
+
+// Function to initialize the explorer data
+void init_explorer(explorer_data &explorer)
+{
+    init_map(explorer.map);
+    init_threat(explorer.threat);
+    explorer.show_threat = false;
+    explorer.editor_tile_kind = NORMAL_TILE;
+    explorer.is_drawing = false;
+    explorer.camera = point_at(0, 0);
+    explorer.zoom_level = DEFAULT_ZOOM_LEVEL;
+    explorer.tile_size = ZOOM_TILE_SIZES[DEFAULT_ZOOM_LEVEL];
+}
+
+// Function to get the color corresponding to a tile kind
+color color_for_tile_kind(tile_kind kind)
+{
+    return TILE_PALETTE[kind];
+}
+
+// Function to initialize the renderer
+void init_renderer(renderer_data &renderer, render_backend backend, int width, int height)
+{
+    renderer.backend = backend;
+    renderer.width = width;
+    renderer.height = height;
+    renderer.camera = point_at(0, 0);
+    renderer.fill_count = 0;
+    if (backend == SOFTWARE_BACKEND)
+    {
+        renderer.pixels.assign(width * height, 0);
+    }
+}
+
+// Function to set the camera position used for world drawing
+void render_set_camera(renderer_data &renderer, const point_2d &camera)
+{
+    renderer.camera = camera;
+    if (renderer.backend == SPLASHKIT_BACKEND)
+    {
+        set_camera_position(camera);
+    }
+}
+
+// Function to fill a rectangle of the software framebuffer, blending by the color's alpha
+void software_fill_rectangle(renderer_data &renderer, color clr, double x, double y, double width, double height)
+{
+    int left = max(0, static_cast<int>(x - renderer.camera.x));
+    int top = max(0, static_cast<int>(y - renderer.camera.y));
+    int right = min(renderer.width, static_cast<int>(x - renderer.camera.x + width));
+    int bottom = min(renderer.height, static_cast<int>(y - renderer.camera.y + height));
+
+    int alpha = alpha_of(clr);
+    int red = red_of(clr), green = green_of(clr), blue = blue_of(clr);
+
+    for (int py = top; py < bottom; py++)
+    {
+        for (int px = left; px < right; px++)
+        {
+            uint32_t &pixel = renderer.pixels[py * renderer.width + px];
+            if (alpha < 255)
+            {
+                int old_red = (pixel >> 16) & 0xFF, old_green = (pixel >> 8) & 0xFF, old_blue = pixel & 0xFF;
+                pixel = ((old_red + (red - old_red) * alpha / 255) << 16) | ((old_green + (green - old_green) * alpha / 255) << 8) | (old_blue + (blue - old_blue) * alpha / 255);
+            }
+            else
+            {
+                pixel = (red << 16) | (green << 8) | blue;
+            }
+        }
+    }
+}
+
+// Function to clear the whole frame to one color
+void render_clear(renderer_data &renderer, color clr)
+{
+    switch (renderer.backend)
+    {
+    case SPLASHKIT_BACKEND:
+        clear_screen(clr);
+        break;
+    case SOFTWARE_BACKEND:
+        fill(renderer.pixels.begin(), renderer.pixels.end(), (red_of(clr) << 16) | (green_of(clr) << 8) | blue_of(clr));
+        break;
+    }
+}
+
+// Function to fill a rectangle given in world coordinates
+void render_fill_rectangle(renderer_data &renderer, color clr, double x, double y, double width, double height)
+{
+    renderer.fill_count++;
+
+    switch (renderer.backend)
+    {
+    case SPLASHKIT_BACKEND:
+        fill_rectangle(clr, x, y, width, height);
+        break;
+    case SOFTWARE_BACKEND:
+        software_fill_rectangle(renderer, clr, x, y, width, height);
+        break;
+    }
+}
+
+// Function to draw the outline of a rectangle given in world coordinates
+void render_draw_rectangle(renderer_data &renderer, color clr, double x, double y, double width, double height)
+{
+    switch (renderer.backend)
+    {
+    case SPLASHKIT_BACKEND:
+        draw_rectangle(clr, x, y, width, height);
+        break;
+    case SOFTWARE_BACKEND:
+        software_fill_rectangle(renderer, clr, x, y, width, 1);
+        software_fill_rectangle(renderer, clr, x, y + height - 1, width, 1);
+        software_fill_rectangle(renderer, clr, x, y, 1, height);
+        software_fill_rectangle(renderer, clr, x + width - 1, y, 1, height);
+        break;
+    }
+}
+
+// Function to draw a bitmap (the software backend has no image data, so it skips bitmaps)
+void render_draw_bitmap(renderer_data &renderer, bitmap bmp, double x, double y)
+{
+    if (renderer.backend == SPLASHKIT_BACKEND)
+    {
+        draw_bitmap(bmp, x, y);
+    }
+}
+
+// Function to draw text (the software backend has no font rasterizer, so it skips text)
+void render_draw_text(renderer_data &renderer, const string &text, color clr, font fnt, int font_size, double x, double y)
+{
+    if (renderer.backend == SPLASHKIT_BACKEND)
+    {
+        draw_text(text, clr, fnt, font_size, x, y);
+    }
+}
+
+// Function to write the software framebuffer to a binary PPM image
+bool write_frame_ppm(const renderer_data &renderer, const string &file_name)
+{
+    ofstream image_file(file_name, ios::binary | ios::trunc);
+    if (!image_file.is_open())
+    {
+        write_line("Failed to open " + file_name + " for writing.");
+        return false;
+    }
+
+    image_file << "P6\n" << renderer.width << " " << renderer.height << "\n255\n";
+
+    vector<char> row(renderer.width * 3);
+    for (int y = 0; y < renderer.height; y++)
+    {
+        for (int x = 0; x < renderer.width; x++)
+        {
+            uint32_t pixel = renderer.pixels[y * renderer.width + x];
+            row[x * 3] = static_cast<char>((pixel >> 16) & 0xFF);
+            row[x * 3 + 1] = static_cast<char>((pixel >> 8) & 0xFF);
+            row[x * 3 + 2] = static_cast<char>(pixel & 0xFF);
+        }
+        image_file.write(row.data(), row.size());
+    }
+    return true;
+}
+
+// Function to draw a finished rectangle of same-kind tiles (its last row is the one before end_r)
+void draw_tile_run(renderer_data &renderer, const tile_run_data &run, int end_r, int tile_size)
+{
+    render_fill_rectangle(renderer, TILE_PALETTE[run.kind], run.start_c * tile_size, run.start_r * tile_size, (run.end_c - run.start_c) * tile_size, (end_r - run.start_r) * tile_size);
+}
+
+// Function to draw a block of tiles as one rectangle in their average color
+// The average comes from the block's kind counts at the given level of detail, so no tiles are read
+void draw_tile_block(renderer_data &renderer, const map_data &map, int level, int block_c, int block_r, int tile_size)
+{
+    int block = LOD_BLOCK_SIZES[level];
+    const uint8_t *counts = map.lod_counts[level][block_c][block_r];
+    int red = 0, green = 0, blue = 0, count = 0;
+
+    for (int kind = 0; kind < TILE_KIND_COUNT; kind++)
+    {
+        color kind_color = TILE_PALETTE[kind];
+        red += counts[kind] * red_of(kind_color);
+        green += counts[kind] * green_of(kind_color);
+        blue += counts[kind] * blue_of(kind_color);
+        count += counts[kind];
+    }
+
+    render_fill_rectangle(renderer, rgb_color(red / count, green / count, blue / count), block_c * block * tile_size, block_r * block * tile_size, block * tile_size, block * tile_size);
+}
+
+// Function to draw the threat heat-map over the visible tiles (closer tiles are drawn stronger)
+void draw_threat_overlay(renderer_data &renderer, const threat_data &threat, const point_2d &camera, int tile_size)
+{
+    TRACK_ALLOCATIONS("draw_threat_overlay");
+
+    int start_col = camera.x / tile_size;
+    int end_col = (camera.x + renderer.width) / tile_size + 1;
+    int start_row = camera.y / tile_size;
+    int end_row = (camera.y + renderer.height) / tile_size + 1;
+
+    if (start_col < 0)
+        start_col = 0;
+    if (start_row < 0)
+        start_row = 0;
+
+    for (int c = start_col; c < end_col && c < MAX_MAP_COLS; c++)
+    {
+        for (int r = start_row; r < end_row && r < MAX_MAP_ROWS; r++)
+        {
+            int dist = threat.dist[c][r];
+            if (dist > 0 && dist < THREAT_UNREACHABLE)
+            {
+                double strength = 0.6 / dist;
+                render_fill_rectangle(renderer, rgba_color(1.0, 0.0, 0.0, strength), c * tile_size, r * tile_size, tile_size, tile_size);
+            }
+        }
+    }
+}
+
+// Function to determine whether a mold is off the visible map
+attention_data mold_visibility(int mold_start_c, int mold_start_r, const point_2d &camera, int tile_size)
+{
+    attention_data attention;
+
+    // Calculate the visible range of columns and rows
+    int map_start_c = camera.x / tile_size;
+    int map_end_c = (camera.x + screen_width()) / tile_size;
+    int map_start_r = camera.y / tile_size;
+    int map_end_r = (camera.y + screen_height()) / tile_size;
+
+    // Determine the relative position of the mold
+    if (mold_start_c < map_start_c)
+    {
+        attention.visibility = OFF_LEFT;
+        attention.new_r = (mold_start_r * tile_size - camera.y) / TILE_HEIGHT; // Position along the screen edge, in icon-sized steps
+
+        // Ensure the new row is within bounds
+        if (attention.new_r < 0)
+            attention.new_r = 0;
+        else if (attention.new_r >= WINDOW_HEIGHT / TILE_HEIGHT)
+            attention.new_r = WINDOW_HEIGHT / TILE_HEIGHT - 1;
+    }
+
+    else if (mold_start_c > map_end_c)
+    {
+        attention.visibility = OFF_RIGHT;
+        attention.new_r = (mold_start_r * tile_size - camera.y) / TILE_HEIGHT; // Position along the screen edge, in icon-sized steps
+
+        // Ensure the new row is within bounds
+        if (attention.new_r < 0)
+            attention.new_r = 0;
+        else if (attention.new_r >= WINDOW_HEIGHT / TILE_HEIGHT)
+            attention.new_r = WINDOW_HEIGHT / TILE_HEIGHT - 1;
+    }
+
+    else if (mold_start_r < map_start_r)
+    {
+        attention.visibility = OFF_TOP;
+        attention.new_c = (mold_start_c * tile_size - camera.x) / TILE_WIDTH; // Position along the screen edge, in icon-sized steps
+
+        // Ensure the new column is within bounds
+        if (attention.new_c < 0)
+            attention.new_c = 0;
+        else if (attention.new_c >= WINDOW_WIDTH / TILE_WIDTH)
+            attention.new_c = WINDOW_WIDTH / TILE_WIDTH - 1;
+    }
+
+    else if (mold_start_r > map_end_r)
+    {
+        attention.visibility = OFF_BOTTOM;
+        attention.new_c = (mold_start_c * tile_size - camera.x) / TILE_WIDTH; // Position along the screen edge, in icon-sized steps
+
+        // Ensure the new column is within bounds
+        if (attention.new_c < 0)
+            attention.new_c = 0;
+        else if (attention.new_c >= WINDOW_WIDTH / TILE_WIDTH)
+            attention.new_c = WINDOW_WIDTH / TILE_WIDTH - 1;
+    }
+
+    else
+    {
+        attention.visibility = VISIBLE;
+    }
+
+    return attention;
+}
+
+// Function to draw the entire map based on the camera position and zoom
+void draw_map(renderer_data &renderer, const map_data &map, const point_2d &camera, int tile_size)
+{
+    TRACK_ALLOCATIONS("draw_map");
+
+    int start_col = camera.x / tile_size;
+    int end_col = (camera.x + renderer.width) / tile_size + 1;
+    int start_row = camera.y / tile_size;
+    int end_row = (camera.y + renderer.height) / tile_size + 1;
+
+    if (start_col < 0)
+        start_col = 0;
+    if (start_row < 0)
+        start_row = 0;
+
+    // When zoomed far out, draw one averaged block per group of tiles from the first level of detail whose blocks are big enough
+    // Blocks are coloured from their kind counts, so both the draws and the CPU work stay bounded by the screen size
+    if (tile_size < LOD_MIN_BLOCK_SIZE)
+    {
+        int level = 0;
+        while (level < LOD_LEVELS - 1 && LOD_BLOCK_SIZES[level] * tile_size < LOD_MIN_BLOCK_SIZE)
+        {
+            level++;
+        }
+        int block = LOD_BLOCK_SIZES[level];
+
+        for (int bc = start_col / block; bc * block < end_col && bc * block < MAX_MAP_COLS; bc++)
+        {
+            for (int br = start_row / block; br * block < end_row && br * block < MAX_MAP_ROWS; br++)
+            {
+                draw_tile_block(renderer, map, level, bc, br, tile_size);
+            }
+        }
+        return;
+    }
+
+    end_col = min(end_col, MAX_MAP_COLS);
+    end_row = min(end_row, MAX_MAP_ROWS);
+
+    // Draw each row as runs of same-kind tiles; a run identical to one on the row above grows that rectangle instead
+    renderer.open_runs.clear();
+    for (int r = start_row; r < end_row; r++)
+    {
+        renderer.row_runs.clear();
+        for (int c = start_col; c < end_col;)
+        {
+            tile_kind kind = map.tiles[c][r].kind;
+            int run_end = c + 1;
+            while (run_end < end_col && map.tiles[run_end][r].kind == kind)
+            {
+                run_end++;
+            }
+            renderer.row_runs.push_back({c, run_end, r, kind});
+            c = run_end;
+        }
+
+        // Both rows split the same columns into runs in order, so matching runs start at the same column
+        int i = 0, j = 0;
+        while (i < renderer.open_runs.size() && j < renderer.row_runs.size())
+        {
+            tile_run_data &open = renderer.open_runs[i];
+            tile_run_data &run = renderer.row_runs[j];
+            if (open.start_c < run.start_c)
+            {
+                draw_tile_run(renderer, open, r, tile_size);
+                i++;
+            }
+            else if (open.start_c > run.start_c)
+            {
+                j++;
+            }
+            else
+            {
+                if (open.end_c == run.end_c && open.kind == run.kind)
+                {
+                    run.start_r = open.start_r;
+                }
+                else
+                {
+                    draw_tile_run(renderer, open, r, tile_size);
+                }
+                i++;
+                j++;
+            }
+        }
+        for (; i < renderer.open_runs.size(); i++)
+        {
+            draw_tile_run(renderer, renderer.open_runs[i], r, tile_size);
+        }
+
+        swap(renderer.open_runs, renderer.row_runs);
+    }
+
+    for (int i = 0; i < renderer.open_runs.size(); i++)
+    {
+        draw_tile_run(renderer, renderer.open_runs[i], end_row, tile_size);
+    }
+}
+
+// Frunction to draw the prepare game interface
+void prepare_interface(renderer_data &renderer, game_data &game, score_store_data &score_store)
+{
+    TRACK_ALLOCATIONS("prepare_interface");
+
+    render_clear(renderer, color_yellow_green());
+
+    render_set_camera(renderer, point_at(0, 0));
+
+    render_draw_bitmap(renderer, MOLD_PIC, (WINDOW_WIDTH - 200) / 2, 0);
+
+    render_draw_text(renderer, "Welcome to Moldbound!", color_dark_olive_green(), TEXT_FONT, 50, 120, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT * 3 - 50 + 50);
+
+    if (button("Start Game: Easy", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT * 2 + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.mold_appearance_time = 10000;
+        game.difficulty = EASY;
+        game.state = PLAYING;
+        reset_timer(GAME_TIMER);
+        start_timer(GAME_TIMER);
+    }
+    if (button("Start Game: Medium", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 - BUTTON_HEIGHT + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.mold_appearance_time = 8000;
+        game.difficulty = MEDIUM;
+        game.state = PLAYING;
+        reset_timer(GAME_TIMER);
+        start_timer(GAME_TIMER);
+    }
+    if (button("Start Game: Hard", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.mold_appearance_time = 5000;
+        game.difficulty = HARD;
+        game.state = PLAYING;
+        reset_timer(GAME_TIMER);
+        start_timer(GAME_TIMER);
+    }
+
+    if (button("Exit Program", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT + 50, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = QUIT;
+    }
+
+    // Switch between steady (BFS) and random (stochastic) mold growth
+    if (button(game.model == BFS_SPREAD ? "Growth: Steady" : "Growth: Random", rectangle_from(2, WINDOW_HEIGHT - BUTTON_HEIGHT - 2, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.model = game.model == BFS_SPREAD ? STOCHASTIC_SPREAD : BFS_SPREAD;
+    }
+
+    // Display the top 5 scores
+    refresh_score_store(score_store);
+    vector<int> top_scores = get_top_5_scores(score_store);
+    for (int i = 0; i < top_scores.size(); i++)
+    {
+        render_draw_text(renderer, to_string(i + 1) + ". " + score_text(top_scores[i]), color_black(), TEXT_FONT, 20, (WINDOW_WIDTH - BUTTON_WIDTH) / 2 + 50, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT + LINE_SPACING + LINE_SPACING * (i + 1) + 50);
+    }
+}
+
+// Function to draw the attention icon for molds that are off the visible map
+void draw_attention_icon(renderer_data &renderer, const snapshot_data &snapshot, const explorer_data &explorer)
+{
+    TRACK_ALLOCATIONS("draw_attention_icon");
+
+    // Draw the attention icon for spreading molds that are off the visible map
+    for (int i = 0; i < snapshot.spreading_molds.size(); i++)
+    {
+        attention_data attention = mold_visibility(snapshot.spreading_molds[i].c, snapshot.spreading_molds[i].r, explorer.camera, explorer.tile_size);
+        switch (attention.visibility)
+        {
+        case OFF_LEFT:
+            render_draw_bitmap(renderer, ATTENTION_ICON, explorer.camera.x, explorer.camera.y + attention.new_r * TILE_HEIGHT);
+            break;
+        case OFF_RIGHT:
+            render_draw_bitmap(renderer, ATTENTION_ICON, explorer.camera.x + WINDOW_WIDTH - TILE_WIDTH, explorer.camera.y + attention.new_r * TILE_HEIGHT);
+            break;
+        case OFF_TOP:
+            render_draw_bitmap(renderer, ATTENTION_ICON, explorer.camera.x + attention.new_c * TILE_WIDTH, explorer.camera.y);
+            break;
+        case OFF_BOTTOM:
+            render_draw_bitmap(renderer, ATTENTION_ICON, explorer.camera.x + attention.new_c * TILE_WIDTH, explorer.camera.y + WINDOW_HEIGHT - TILE_HEIGHT);
+            break;
+        case VISIBLE:
+            break;
+        }
+    }
+}
+
+// Function to draw the playing interface
+void playing_interface(renderer_data &renderer, const explorer_data &explorer, const snapshot_data &snapshot, game_data &game)
+{
+    TRACK_ALLOCATIONS("playing_interface");
+
+    render_set_camera(renderer, explorer.camera);
+
+    render_clear(renderer, color_white());
+
+    draw_map(renderer, snapshot.map, explorer.camera, explorer.tile_size);
+
+    if (explorer.show_threat)
+    {
+        draw_threat_overlay(renderer, snapshot.threat, explorer.camera, explorer.tile_size);
+    }
+
+    draw_attention_icon(renderer, snapshot, explorer);
+
+    // Draw the editor to change tile kind
+    render_draw_text(renderer, "Editor: Enter 1 for BORDER_TILE, 2 for NORMAL_TILE", color_sea_green(), TEXT_FONT, 15, explorer.camera.x, explorer.camera.y);
+    render_draw_rectangle(renderer, color_black(), explorer.camera.x, explorer.camera.y + 10 + LINE_SPACING, 50, 50);
+    render_fill_rectangle(renderer, color_for_tile_kind(explorer.editor_tile_kind), explorer.camera.x + 10, explorer.camera.y + 20 + LINE_SPACING, 30, 30);
+    render_draw_rectangle(renderer, color_black(), explorer.camera.x + 10, explorer.camera.y + LINE_SPACING * 2, 30, 30);
+
+    render_draw_text(renderer, "Percentage of map unavailable: " + to_string(snapshot.broken_proportion + snapshot.border_proportion) + "%", color_sea_green(), TEXT_FONT, 15, explorer.camera.x, explorer.camera.y + 10 + LINE_SPACING * 4);
+    render_draw_text(renderer, "Press H to toggle the threat map, - and = to zoom, Z/Y to undo/redo", color_sea_green(), TEXT_FONT, 15, explorer.camera.x, explorer.camera.y + 10 + LINE_SPACING * 5);
+
+    if (button("Pause Game", rectangle_from(WINDOW_WIDTH - BUTTON_WIDTH, 0, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = PAUSING;
+        pause_timer(GAME_TIMER);
+    }
+}
+
+// Function to draw the pausing interface
+void pausing_interface(game_data &game)
+{
+    TRACK_ALLOCATIONS("pausing_interface");
+
+    if (button("Resume Game", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = PLAYING;
+        resume_timer(GAME_TIMER);
+    }
+    if (button("Quit Game", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = PREPARE_GAME;
+    }
+}
+
+// Function to draw the game over interface
+void game_over_interface(renderer_data &renderer, const explorer_data &explorer, game_data &game, score_store_data &score_store)
+{
+    TRACK_ALLOCATIONS("game_over_interface");
+
+    if (sound_effect_playing(DRAWING_SOUND))
+    {
+        stop_sound_effect(DRAWING_SOUND);
+    }
+
+    render_draw_text(renderer, "Game Over", color_red(), TEXT_FONT, 15, explorer.camera.x + 300 + 70, explorer.camera.y + 280);
+    render_draw_text(renderer, "You survived for " + to_string(game.score) + " seconds.", color_red(), TEXT_FONT, 15, explorer.camera.x + 300, explorer.camera.y + 280 + LINE_SPACING);
+
+    // Save the score to a file
+    if (game.is_player_score_saved == false)
+    {
+        game.is_player_score_saved = save_score_to_file(game, score_store);
+    }
+
+    if (game.is_player_score_saved)
+    {
+        render_draw_text(renderer, "Rank " + to_string(game.rank) + " on " + difficulty_name(game.difficulty) + " (top " + to_string(static_cast<int>(game.top_percent + 0.5)) + "%)", color_red(), TEXT_FONT, 15, explorer.camera.x + 300, explorer.camera.y + 280 + LINE_SPACING * 2);
+    }
+
+    if (button("Back to Home", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 40, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = PREPARE_GAME;
+    }
+    if (button("Exit Program", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 40 + BUTTON_HEIGHT, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    {
+        game.state = QUIT;
+    }
+}
+
+// Function to draw the sound button
+void draw_sound_button(game_effect_data &game_effect)
+{
+    TRACK_ALLOCATIONS("draw_sound_button");
+
+    bitmap sound_state;
+    if (game_effect.is_sound_on)
+    {
+        sound_state = SOUND_ON_ICON;
+    }
+    else
+    {
+        sound_state = SOUND_OFF_ICON;
+    }
+
+    if (bitmap_button(sound_state, rectangle_from(WINDOW_WIDTH - 52, WINDOW_HEIGHT - 52, 50, 50)))
+    {
+        if (!game_effect.is_sound_on)
+        {
+            set_music_volume(MUSIC_VOLUME);
+            game_effect.is_sound_on = true;
+        }
+        else
+        {
+            set_music_volume(0);
+            game_effect.is_sound_on = false;
+        }
+    }
+}
+
+#ifdef MOLDBOUND_ALLOC_TRACKING
+// Function to add one set of allocation counts to another
+void add_alloc_counts(alloc_counts_data &sum, const alloc_counts_data &counts)
+{
+    sum.allocations += counts.allocations;
+    sum.bytes += counts.bytes;
+    sum.copies += counts.copies;
+    sum.copied_bytes += counts.copied_bytes;
+}
+
+// Function to raise each count of a peak to the matching count of a frame, if that is higher
+void raise_alloc_peak(alloc_counts_data &peak, const alloc_counts_data &counts)
+{
+    peak.allocations = max(peak.allocations, counts.allocations);
+    peak.bytes = max(peak.bytes, counts.bytes);
+    peak.copies = max(peak.copies, counts.copies);
+    peak.copied_bytes = max(peak.copied_bytes, counts.copied_bytes);
+}
+
+// Function to get the number of scopes in use, including the untracked scope 0
+int alloc_scope_count()
+{
+    return min(alloc_tracker.scope_count.load(memory_order_relaxed) + 1, MAX_ALLOC_SCOPES);
+}
+
+// Function to get the name a scope is shown with
+string alloc_scope_name(int scope)
+{
+    const char *name = alloc_tracker.scopes[scope].name;
+    return name == nullptr ? "(untracked)" : name;
+}
+
+// Function to finish the frame's allocation counts (called by the main thread once per frame, drawn or skipped)
+void end_alloc_frame()
+{
+    alloc_counts_data frame = {0, 0, 0, 0};
+
+    for (int i = 0; i < alloc_scope_count(); i++)
+    {
+        alloc_scope_data &scope = alloc_tracker.scopes[i];
+
+        alloc_counts_data counts;
+        counts.allocations = scope.frame_allocations.exchange(0, memory_order_relaxed);
+        counts.bytes = scope.frame_bytes.exchange(0, memory_order_relaxed);
+        counts.copies = scope.frame_copies.exchange(0, memory_order_relaxed);
+        counts.copied_bytes = scope.frame_copied_bytes.exchange(0, memory_order_relaxed);
+
+        scope.last = counts;
+        add_alloc_counts(scope.total, counts);
+        raise_alloc_peak(scope.peak, counts);
+        add_alloc_counts(frame, counts);
+    }
+
+    alloc_tracker.last_frame = frame;
+    alloc_tracker.frames++;
+    if (frame.allocations == 0 && frame.copies == 0)
+    {
+        alloc_tracker.quiet_frames++;
+    }
+}
+
+// Function to draw the allocation overlay: the last frame's counts and the functions that allocated or copied the most in it
+void draw_alloc_overlay(renderer_data &renderer)
+{
+    alloc_scope_guard overlay_scope(ALLOC_SCOPE_IGNORED); // The overlay's own text is not counted
+
+    // Order the scopes by how much they did in the last frame
+    int order[MAX_ALLOC_SCOPES];
+    int scope_count = alloc_scope_count();
+    for (int i = 0; i < scope_count; i++)
+    {
+        order[i] = i;
+    }
+    sort(order, order + scope_count, [](int a, int b)
+         { return alloc_tracker.scopes[a].last.allocations + alloc_tracker.scopes[a].last.copies >
+                  alloc_tracker.scopes[b].last.allocations + alloc_tracker.scopes[b].last.copies; });
+
+    double x = renderer.camera.x + WINDOW_WIDTH - 340;
+    double y = renderer.camera.y + BUTTON_HEIGHT + 5;
+    render_fill_rectangle(renderer, rgba_color(0.0, 0.0, 0.0, 0.6), x, y, 340, LINE_SPACING * (ALLOC_OVERLAY_SCOPES + 2) + 4);
+
+    const alloc_counts_data &frame = alloc_tracker.last_frame;
+    render_draw_text(renderer, "Frame: " + to_string(frame.allocations) + " allocs (" + to_string(frame.bytes) + " B), " + to_string(frame.copies) + " copies (" + to_string(frame.copied_bytes) + " B)", color_white(), TEXT_FONT, 12, x + 4, y + 2);
+    render_draw_text(renderer, "Frames without allocations: " + to_string(alloc_tracker.quiet_frames) + " of " + to_string(alloc_tracker.frames), color_white(), TEXT_FONT, 12, x + 4, y + 2 + LINE_SPACING);
+
+    for (int i = 0; i < ALLOC_OVERLAY_SCOPES && i < scope_count; i++)
+    {
+        const alloc_scope_data &scope = alloc_tracker.scopes[order[i]];
+        if (scope.last.allocations == 0 && scope.last.copies == 0)
+        {
+            break;
+        }
+        render_draw_text(renderer, alloc_scope_name(order[i]) + ": " + to_string(scope.last.allocations) + " allocs, " + to_string(scope.last.copies) + " copies", color_yellow(), TEXT_FONT, 12, x + 4, y + 2 + LINE_SPACING * (i + 2));
+    }
+}
+
+// Function to write the allocation report: counts per function over every frame, as JSON
+bool write_alloc_report(const string &file_name)
+{
+    alloc_scope_guard report_scope(ALLOC_SCOPE_IGNORED);
+
+    ofstream report(file_name);
+    if (!report.is_open())
+    {
+        write_line("Could not write " + file_name);
+        return false;
+    }
+
+    report << "{\n  \"frames\": " << alloc_tracker.frames << ",\n  \"frames_without_allocations\": " << alloc_tracker.quiet_frames << ",\n  \"functions\": [";
+    bool is_first = true;
+    for (int i = 0; i < alloc_scope_count(); i++)
+    {
+        const alloc_scope_data &scope = alloc_tracker.scopes[i];
+        if (scope.total.allocations == 0 && scope.total.copies == 0)
+        {
+            continue;
+        }
+
+        report << (is_first ? "\n" : ",\n")
+               << "    {\"name\": \"" << alloc_scope_name(i) << "\""
+               << ", \"allocations\": " << scope.total.allocations
+               << ", \"bytes\": " << scope.total.bytes
+               << ", \"large_copies\": " << scope.total.copies
+               << ", \"copied_bytes\": " << scope.total.copied_bytes
+               << ", \"allocations_per_frame\": " << static_cast<double>(scope.total.allocations) / max(alloc_tracker.frames, 1L)
+               << ", \"peak_allocations\": " << scope.peak.allocations
+               << ", \"peak_copies\": " << scope.peak.copies << "}";
+        is_first = false;
+    }
+    report << "\n  ]\n}\n";
+
+    write_line("Allocation report written to " + file_name);
+    return true;
+}
+#endif
+
+// Function to draw the corresponding interface based on the game state
+void draw_explorer(renderer_data &renderer, const explorer_data &explorer, const snapshot_data &snapshot, game_data &game, game_effect_data &game_effect, score_store_data &score_store)
+{
+
+    // Draw the interface based on the game state
+    switch (game.state)
+    {
+    case PREPARE_GAME:
+        prepare_interface(renderer, game, score_store);
+        break;
+    case PLAYING:
+        playing_interface(renderer, explorer, snapshot, game);
+        break;
+    case PAUSING:
+        pausing_interface(game);
+        break;
+    case GAME_OVER:
+        game_over_interface(renderer, explorer, game, score_store);
+        break;
+    case QUIT:
+        break;
+    }
+
+    draw_sound_button(game_effect);
+
+#ifdef MOLDBOUND_ALLOC_TRACKING
+    if (alloc_tracker.show_overlay)
+    {
+        draw_alloc_overlay(renderer);
+    }
+#endif
+
+    draw_interface();
+    refresh_screen();
+}
+
+// Function to initialize the frame invalidation state (nothing drawn yet)
+frame_invalidation_data init_frame_invalidation()
+{
+    frame_invalidation_data invalidation;
+    invalidation.is_drawn = false;
+    invalidation.skipped_frames = 0;
+    return invalidation;
+}
+
+// Function to record what the next frame would be drawn from
+frame_record_data record_frame(const explorer_data &explorer, const snapshot_data &snapshot, const game_data &game, const game_effect_data &game_effect)
+{
+    frame_record_data frame;
+    frame.state = game.state;
+    frame.mouse = mouse_position();
+    frame.is_mouse_down = mouse_down(LEFT_BUTTON);
+    frame.is_mouse_clicked = mouse_clicked(LEFT_BUTTON);
+    frame.is_sound_on = game_effect.is_sound_on;
+    frame.model = game.model;
+    frame.camera = explorer.camera;
+    frame.tile_size = explorer.tile_size;
+    frame.show_threat = explorer.show_threat;
+    frame.editor_tile_kind = explorer.editor_tile_kind;
+    frame.snapshot_version = game.state == PLAYING ? snapshot.version : 0; // Only the playing screen draws the snapshot
+    frame.is_player_score_saved = game.is_player_score_saved;
+    return frame;
+}
+
+// Function to check if the next frame would look different from the one on screen, and remember it if so
+// Buttons act on a click while they are drawn, so a frame with a click is always drawn, even if the click left the mouse state as it was.
+bool frame_needs_redraw(frame_invalidation_data &invalidation, const frame_record_data &frame)
+{
+    // Keep drawing the game over screen until its score is saved, as that is retried each frame
+    bool is_saving_score = frame.state == GAME_OVER && !frame.is_player_score_saved;
+
+    // The allocation overlay changes every frame, and its counts should include the drawing code
+    bool is_overlay_shown = false;
+#ifdef MOLDBOUND_ALLOC_TRACKING
+    is_overlay_shown = alloc_tracker.show_overlay;
+#endif
+
+    if (invalidation.is_drawn && frame.same_as(invalidation.last) && !frame.is_mouse_clicked && !is_saving_score && !is_overlay_shown)
+    {
+        invalidation.skipped_frames++;
+        return false;
+    }
+
+    invalidation.is_drawn = true;
+    invalidation.last = frame;
+    return true;
+}
+
+// Function to check if the editor can change a tile of one kind to another
+bool can_edit_tile(tile_kind current_kind, tile_kind editor_kind)
+{
+    switch (editor_kind)
+    {
+    case NORMAL_TILE:
+        return current_kind == FIX_TILE || current_kind == BORDER_TILE;
+    case BORDER_TILE:
+        return current_kind == NORMAL_TILE;
+    default:
+        return false;
+    }
+}
+
+// Function to queue an editor command that has no tile (ending a stroke, undo or redo; returns false if the queue is full)
+// These may use the slots tile edits leave free, so a burst of edits cannot crowd them out.
+bool push_editor_action(editor_command_queue_data &commands, editor_action action)
+{
+    editor_command_data command;
+    command.action = action;
+    command.c = 0;
+    command.r = 0;
+    command.kind = NORMAL_TILE;
+    return commands.push(command);
+}
+
+// Function to handle input for editing the map (edits are checked against the snapshot and queued for the simulation thread)
+void handle_editor_input(explorer_data &explorer, game_effect_data &game_effect, const snapshot_data &snapshot, editor_command_queue_data &commands)
+{
+    TRACK_ALLOCATIONS("handle_editor_input");
+
+    // Change the tile kind based on key input
+    if (key_typed(NUM_1_KEY))
+    {
+        explorer.editor_tile_kind = BORDER_TILE;
+    }
+    if (key_typed(NUM_2_KEY))
+    {
+        explorer.editor_tile_kind = NORMAL_TILE;
+    }
+
+    // Undo and redo whole brush strokes
+    if (key_typed(Z_KEY))
+    {
+        push_editor_action(commands, UNDO_STROKE);
+    }
+    if (key_typed(Y_KEY))
+    {
+        push_editor_action(commands, REDO_STROKE);
+    }
+
+    // Handle mouse input for drawing tiles
+    if (mouse_down(LEFT_BUTTON))
+    {
+        explorer.is_drawing = true;
+
+        point_2d mouse_pos = mouse_position();
+        int c = (mouse_pos.x + explorer.camera.x) / explorer.tile_size;
+        int r = (mouse_pos.y + explorer.camera.y) / explorer.tile_size;
+
+        if (c >= 0 && c < MAX_MAP_COLS && r >= 0 && r < MAX_MAP_ROWS)
+        {
+
+            if (!sound_effect_playing(DRAWING_SOUND))
+            {
+                if (game_effect.is_sound_on)
+                {
+                    play_sound_effect(DRAWING_SOUND);
+                }
+            }
+
+            if (can_edit_tile(snapshot.map.tiles[c][r].kind, explorer.editor_tile_kind))
+            {
+                editor_command_data command;
+                command.action = EDIT_TILE;
+                command.c = c;
+                command.r = r;
+                command.kind = explorer.editor_tile_kind;
+                commands.push(command, EDITOR_CONTROL_SLOTS);
+            }
+        }
+    }
+    else
+    {
+        stop_sound_effect(DRAWING_SOUND);
+
+        // Lifting the brush ends the stroke (tried again next frame if even the control slots are full)
+        if (explorer.is_drawing && push_editor_action(commands, END_STROKE))
+        {
+            explorer.is_drawing = false;
+        }
+    }
+}
+
+// Function to change the zoom level, keeping the tile at the center of the screen in place
+void set_zoom_level(explorer_data &explorer, int zoom_level)
+{
+    if (zoom_level < 0 || zoom_level >= ZOOM_LEVELS)
+    {
+        return;
+    }
+
+    int new_tile_size = ZOOM_TILE_SIZES[zoom_level];
+    double center_x = (explorer.camera.x + WINDOW_WIDTH / 2) / explorer.tile_size;
+    double center_y = (explorer.camera.y + WINDOW_HEIGHT / 2) / explorer.tile_size;
+
+    explorer.camera.x = center_x * new_tile_size - WINDOW_WIDTH / 2;
+    explorer.camera.y = center_y * new_tile_size - WINDOW_HEIGHT / 2;
+    explorer.zoom_level = zoom_level;
+    explorer.tile_size = new_tile_size;
+}
+
+// Function to handle general input for the explorer
+void handle_input(explorer_data &explorer, game_effect_data &game_effect, const snapshot_data &snapshot, editor_command_queue_data &commands)
+{
+    TRACK_ALLOCATIONS("handle_input");
+
+    handle_editor_input(explorer, game_effect, snapshot, commands);
+
+    if (key_typed(H_KEY))
+    {
+        explorer.show_threat = !explorer.show_threat;
+    }
+
+    // Zoom in and out
+    if (key_typed(EQUALS_KEY))
+    {
+        set_zoom_level(explorer, explorer.zoom_level - 1);
+    }
+    if (key_typed(MINUS_KEY))
+    {
+        set_zoom_level(explorer, explorer.zoom_level + 1);
+    }
+
+    if (key_down(LEFT_KEY))
+    {
+        explorer.camera.x -= 2;
+    }
+    if (key_down(RIGHT_KEY))
+    {
+        explorer.camera.x += 2;
+    }
+    if (key_down(UP_KEY))
+    {
+        explorer.camera.y -= 2;
+    }
+    if (key_down(DOWN_KEY))
+    {
+        explorer.camera.y += 2;
+    }
+}
+
+// Function to spread new molds
+void spread_new_molds(map_data &map, game_data &game, long current_time)
+{
+    TRACK_ALLOCATIONS("spread_new_molds");
+
+    // Check if there is space available for mold to spread
+    if (is_space_available(map))
+    {
+        // Check if it's time for the next mold to appear
+        if (game.molds.is_time_to_appear_next(current_time))
+        {
+            // New molds wait while every mold ID is in use
+            uint8_t id = next_free_mold_id(game.molds);
+            if (id == 0)
+            {
+                return;
+            }
+
+            // Select a random starting position for the new mold
+            int start_c, start_r;
+            do
+            {
+                start_c = rnd(0, MAX_MAP_COLS - 1);
+                start_r = rnd(0, MAX_MAP_ROWS - 1);
+            } while (map.tiles[start_c][start_r].kind != NORMAL_TILE);
+
+            game.molds.v.emplace_back();               // Add new mold to the vector
+            mold_data &new_mold = game.molds.v.back(); // and build it there rather than copying it in
+
+            // Reuse the frontier buffer of a removed mold
+            if (!game.molds.spare_frontiers.empty())
+            {
+                new_mold.q.cells = move(game.molds.spare_frontiers.back());
+                game.molds.spare_frontiers.pop_back();
+            }
+
+            init_mold_in_place(new_mold, start_c, start_r, id, current_time); // Initialize new mold
+            new_mold.model = game.model;                                      // Grow it the way chosen for this game
+
+            game.molds.time_to_appear_next = current_time + game.mold_appearance_time + rnd(0, 2000); // Set time for next mold appearance
+        }
+    }
+}
+
+// Function to update current molds
+void update_current_molds(game_data &game, map_data &map, threat_data &threat, long current_time)
+{
+    TRACK_ALLOCATIONS("update_current_molds");
+
+    if (game.model == STOCHASTIC_SPREAD)
+    {
+        spread_molds_stochastic(map, game.molds, threat, game.stochastic, current_time);
+    }
+
+    if (!game.molds.v.empty())
+    {
+        for (int i = 0; i < game.molds.v.size(); i++)
+        {
+            // Handle mold lifecycle
+            handle_mold_lifecycle(map, game.molds.v[i], threat, current_time);
+
+            // Remove finished molds, keeping their frontier buffers for the next ones
+            if (game.molds.v[i].state == BROKEN)
+            {
+                game.molds.spare_frontiers.push_back(move(game.molds.v[i].q.cells));
+                game.molds.v.erase(game.molds.v.begin() + i);
+                i--;
+            }
+        }
     }
-    if (button("Quit Game", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + BUTTON_HEIGHT, BUTTON_WIDTH, BUTTON_HEIGHT)))
+}
+
+// Function to get the time until the next mold appears, spreads or breaks (in milliseconds)
+long time_to_next_mold_event(const game_data &game, long current_time)
+{
+    long next_event = game.molds.time_to_appear_next;
+
+    for (int i = 0; i < game.molds.v.size(); i++)
     {
-        game.state = PREPARE_GAME;
+        const mold_data &mold = game.molds.v[i];
+        if (mold.state == SPREADING)
+        {
+            next_event = min(next_event, mold.last_spread_time + MOLD_SPREAD_TIME);
+        }
+        else if (mold.state == FIXING)
+        {
+            next_event = min(next_event, mold.time_to_start_fix + 1);
+        }
+        else
+        {
+            next_event = current_time; // The mold changes state on the next update
+        }
     }
+
+    return max(0L, next_event - current_time);
 }
 
-// Function to draw the game over interface
-void game_over_interface(explorer_data explorer, game_data &game)
+// Function to apply an editor edit to the map, if the tile can still be changed (returns false if it could not)
+bool apply_editor_command(map_data &map, threat_data &threat, const editor_command_data &command)
 {
-    if (sound_effect_playing("Drawing Sound"))
+    int c = command.c;
+    int r = command.r;
+
+    if (!can_edit_tile(map.tiles[c][r].kind, command.kind))
     {
-        stop_sound_effect("Drawing Sound");
+        return false;
     }
 
-    draw_text("Game Over", color_red(), "Text Font", 15, explorer.camera.x + 300 + 70, explorer.camera.y + 280);
-    draw_text("You survived for " + to_string(game.score) + " seconds.", color_red(), "Text Font", 15, explorer.camera.x + 300, explorer.camera.y + 280 + LINE_SPACING);
+    if (command.kind == NORMAL_TILE)
+    {
+        // Credit the repair to the mold that owns the tile
+        if (map.tiles[c][r].kind == FIX_TILE && map.owner[c][r] != 0)
+        {
+            remove_live_tile(map, c, r);
+        }
+        set_tile_kind(map, c, r, command.kind);
+        open_threat_tile(map, threat, c, r);
+    }
 
-    // Save the score to a file
-    if (game.is_player_score_saved == false)
+    if (command.kind == BORDER_TILE)
     {
-        game.is_player_score_saved = save_score_to_file(game);
+        set_tile_kind(map, c, r, command.kind);
+        close_threat_tile(map, threat, c, r);
     }
+    return true;
+}
 
-    if (button("Back to Home", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 40, BUTTON_WIDTH, BUTTON_HEIGHT)))
+// Function to reset the editor history (the ring buffers are only allocated for the first game)
+void init_editor_history(editor_history_data &history)
+{
+    history.runs.resize(HISTORY_RUN_CAPACITY);
+    history.strokes.resize(HISTORY_STROKE_CAPACITY);
+    history.oldest_run = 0;
+    history.next_run = 0;
+    history.oldest_stroke = 0;
+    history.undo_cursor = 0;
+    history.redo_end = 0;
+    history.is_stroke_open = false;
+    history.open_first_run = 0;
+}
+
+// Function to forget the oldest stroke in the history
+void drop_oldest_stroke(editor_history_data &history)
+{
+    history.oldest_stroke++;
+    if (history.oldest_stroke < history.undo_cursor)
     {
-        game.state = PREPARE_GAME;
+        history.oldest_run = history.strokes[history.oldest_stroke % HISTORY_STROKE_CAPACITY].first_run;
     }
-    if (button("Exit Program", rectangle_from((WINDOW_WIDTH - BUTTON_WIDTH) / 2, (WINDOW_HEIGHT - BUTTON_HEIGHT) / 2 + 40 + BUTTON_HEIGHT, BUTTON_WIDTH, BUTTON_HEIGHT)))
+    else
     {
-        game.state = QUIT;
+        history.oldest_run = history.open_first_run;
     }
 }
 
-// Function to draw the sound button
-void draw_sound_button(game_effect_data &game_effect)
+// Function to add an applied edit to the open stroke (a new stroke is opened if there is none, which drops the strokes that could be redone)
+void record_edit(editor_history_data &history, int c, int r, tile_kind old_kind, tile_kind new_kind)
 {
-    bitmap sound_state;
-    if (game_effect.is_sound_on)
+    uint32_t index = static_cast<uint32_t>(c * MAX_MAP_ROWS + r);
+
+    if (!history.is_stroke_open)
     {
-        sound_state = SOUND_ON_ICON;
+        history.redo_end = history.undo_cursor;
+        if (history.undo_cursor > history.oldest_stroke)
+        {
+            const stroke_data &last = history.strokes[(history.undo_cursor - 1) % HISTORY_STROKE_CAPACITY];
+            history.next_run = last.first_run + last.run_count;
+        }
+        else
+        {
+            history.next_run = history.oldest_run;
+        }
+        history.open_first_run = history.next_run;
+        history.is_stroke_open = true;
     }
-    else
+
+    // Extend the stroke's last run when this tile continues it
+    if (history.next_run > history.open_first_run)
     {
-        sound_state = SOUND_OFF_ICON;
+        delta_run_data &last = history.runs[(history.next_run - 1) % HISTORY_RUN_CAPACITY];
+        if (last.start + last.length == index && last.old_kind == old_kind && last.new_kind == new_kind && last.length < MAX_RUN_LENGTH)
+        {
+            last.length++;
+            return;
+        }
     }
 
-    if (bitmap_button(sound_state, rectangle_from(WINDOW_WIDTH - 52, WINDOW_HEIGHT - 52, 50, 50)))
+    // Make room by forgetting the oldest strokes (or, when one stroke fills the whole history, its own oldest runs)
+    while (history.next_run - history.oldest_run >= HISTORY_RUN_CAPACITY)
     {
-        if (!game_effect.is_sound_on)
+        if (history.oldest_stroke < history.undo_cursor)
         {
-            set_music_volume(MUSIC_VOLUME);
-            game_effect.is_sound_on = true;
+            drop_oldest_stroke(history);
         }
         else
         {
-            set_music_volume(0);
-            game_effect.is_sound_on = false;
+            history.oldest_run++;
+            history.open_first_run = history.oldest_run;
         }
     }
+
+    delta_run_data &run = history.runs[history.next_run % HISTORY_RUN_CAPACITY];
+    run.start = index;
+    run.length = 1;
+    run.old_kind = static_cast<uint8_t>(old_kind);
+    run.new_kind = static_cast<uint8_t>(new_kind);
+    history.next_run++;
 }
 
-// Function to draw the corresponding interface based on the game state
-void draw_explorer(const explorer_data &explorer, game_data &game, game_effect_data &game_effect)
+// Function to close the open stroke so that it can be undone as one step
+void end_stroke(editor_history_data &history)
 {
+    if (!history.is_stroke_open)
+    {
+        return;
+    }
 
-    // Draw the interface based on the game state
-    switch (game.state)
+    if (history.undo_cursor - history.oldest_stroke >= HISTORY_STROKE_CAPACITY)
     {
-    case PREPARE_GAME:
-        prepare_interface(game);
-        break;
-    case PLAYING:
-        playing_interface(explorer, game);
-        break;
-    case PAUSING:
-        pausing_interface(game);
-        break;
-    case GAME_OVER:
-        game_over_interface(explorer, game);
-        break;
-    case QUIT:
-        break;
+        drop_oldest_stroke(history);
     }
 
-    draw_sound_button(game_effect);
+    stroke_data &stroke = history.strokes[history.undo_cursor % HISTORY_STROKE_CAPACITY];
+    stroke.first_run = history.open_first_run;
+    stroke.run_count = history.next_run - history.open_first_run;
+    history.undo_cursor++;
+    history.redo_end = history.undo_cursor;
+    history.is_stroke_open = false;
+}
 
-    draw_interface();
-    refresh_screen();
+// Function to change one tile of a stroke to the given kind, if the editor could still make that change
+void apply_stroke_tile(map_data &map, threat_data &threat, uint32_t index, uint8_t kind)
+{
+    editor_command_data command;
+    command.action = EDIT_TILE;
+    command.c = index / MAX_MAP_ROWS;
+    command.r = index % MAX_MAP_ROWS;
+    command.kind = static_cast<tile_kind>(kind);
+    apply_editor_command(map, threat, command);
 }
 
-// Function to handle input for editing the map
-void handle_editor_input(explorer_data &explorer, game_effect_data &game_effect)
+// Function to undo the last stroke (tiles the molds have taken since are left alone)
+void undo_stroke(map_data &map, threat_data &threat, editor_history_data &history)
 {
-    // Change the tile kind based on key input
-    if (key_typed(NUM_1_KEY))
+    end_stroke(history);
+    if (history.undo_cursor == history.oldest_stroke)
     {
-        explorer.editor_tile_kind = BORDER_TILE;
+        return;
     }
-    if (key_typed(NUM_2_KEY))
+
+    history.undo_cursor--;
+    const stroke_data &stroke = history.strokes[history.undo_cursor % HISTORY_STROKE_CAPACITY];
+    for (long i = stroke.run_count - 1; i >= 0; i--)
     {
-        explorer.editor_tile_kind = NORMAL_TILE;
+        const delta_run_data &run = history.runs[(stroke.first_run + i) % HISTORY_RUN_CAPACITY];
+        for (int j = run.length - 1; j >= 0; j--)
+        {
+            apply_stroke_tile(map, threat, run.start + j, run.old_kind);
+        }
     }
+}
 
-    // Handle mouse input for drawing tiles
-    if (mouse_down(LEFT_BUTTON))
+// Function to redo the last undone stroke
+void redo_stroke(map_data &map, threat_data &threat, editor_history_data &history)
+{
+    end_stroke(history);
+    if (history.undo_cursor == history.redo_end)
     {
+        return;
+    }
 
-        point_2d mouse_pos = mouse_position();
-        int c = (mouse_pos.x + explorer.camera.x) / TILE_WIDTH;
-        int r = (mouse_pos.y + explorer.camera.y) / TILE_HEIGHT;
+    const stroke_data &stroke = history.strokes[history.undo_cursor % HISTORY_STROKE_CAPACITY];
+    for (long i = 0; i < stroke.run_count; i++)
+    {
+        const delta_run_data &run = history.runs[(stroke.first_run + i) % HISTORY_RUN_CAPACITY];
+        for (int j = 0; j < run.length; j++)
+        {
+            apply_stroke_tile(map, threat, run.start + j, run.new_kind);
+        }
+    }
+    history.undo_cursor++;
+}
 
-        if (c >= 0 && c < MAX_MAP_COLS && r >= 0 && r < MAX_MAP_ROWS)
+// Function to carry out one command from the editor (returns true if it may have changed the map)
+bool handle_editor_command(simulation_data &simulation, const editor_command_data &command)
+{
+    TRACK_ALLOCATIONS("handle_editor_command");
+
+    switch (command.action)
+    {
+    case EDIT_TILE:
+    {
+        tile_kind old_kind = simulation.map.tiles[command.c][command.r].kind;
+        if (apply_editor_command(simulation.map, simulation.threat, command))
         {
+            record_edit(simulation.history, command.c, command.r, old_kind, command.kind);
+            return true;
+        }
+        return false;
+    }
+    case END_STROKE:
+        end_stroke(simulation.history);
+        return false;
+    case UNDO_STROKE:
+        undo_stroke(simulation.map, simulation.threat, simulation.history);
+        return true;
+    case REDO_STROKE:
+        redo_stroke(simulation.map, simulation.threat, simulation.history);
+        return true;
+    }
+    return false;
+}
 
-            if (!sound_effect_playing("Drawing Sound"))
-            {
-                if (game_effect.is_sound_on)
-                {
-                    play_sound_effect("Drawing Sound");
-                }
-            }
+// Function to copy the simulation's current state into its back snapshot slot and hand it to the main thread
+void publish_snapshot(simulation_data &simulation)
+{
+    TRACK_ALLOCATIONS("publish_snapshot");
 
-            if (explorer.editor_tile_kind == NORMAL_TILE)
-            {
-                if (explorer.map.tiles[c][r].kind == FIX_TILE || explorer.map.tiles[c][r].kind == BORDER_TILE)
-                {
-                    explorer.map.tiles[c][r].kind = explorer.editor_tile_kind;
-                }
-            }
+    snapshot_data &snapshot = simulation.snapshots.back_slot();
 
-            if (explorer.editor_tile_kind == BORDER_TILE)
-            {
-                if (explorer.map.tiles[c][r].kind == NORMAL_TILE)
-                {
-                    explorer.map.tiles[c][r].kind = explorer.editor_tile_kind;
-                }
-            }
+    // The main thread only draws and checks tiles, so owners and live lists stay with the simulation
+    copy(&simulation.map.tiles[0][0], &simulation.map.tiles[0][0] + MAX_MAP_COLS * MAX_MAP_ROWS, &snapshot.map.tiles[0][0]);
+    copy(&simulation.map.lod_counts[0][0][0][0], &simulation.map.lod_counts[0][0][0][0] + sizeof(simulation.map.lod_counts), &snapshot.map.lod_counts[0][0][0][0]);
+    snapshot.threat = simulation.threat;
+
+    snapshot.spreading_molds.clear();
+    for (int i = 0; i < simulation.game.molds.v.size(); i++)
+    {
+        if (simulation.game.molds.v[i].state == SPREADING)
+        {
+            snapshot.spreading_molds.push_back(simulation.game.molds.v[i].start_loc);
         }
     }
-    else
+
+    snapshot.broken_proportion = simulation.game.broken_proportion;
+    snapshot.border_proportion = simulation.game.border_proportion;
+    snapshot.is_game_over = simulation.game.state == GAME_OVER;
+    snapshot.score = simulation.game.score;
+    snapshot.version = ++simulation.published;
+
+    simulation.snapshots.publish();
+}
+
+// Function to reset the simulation for a new game with the settings chosen on the menu (only while its thread is not running)
+void init_simulation(simulation_data &simulation, const game_data &settings)
+{
+    init_map(simulation.map);
+    init_threat(simulation.threat);
+    simulation.threat.parallel = &simulation.threat_parallel;
+    simulation.game = init_game();
+    simulation.game.mold_appearance_time = settings.mold_appearance_time;
+    simulation.game.difficulty = settings.difficulty;
+    simulation.game.model = settings.model;
+    simulation.game.state = PLAYING;
+    init_stochastic_spread(simulation.game.stochastic, static_cast<uint64_t>(time(nullptr)), settings.difficulty);
+
+    simulation.commands.head.store(0);
+    simulation.commands.tail.store(0);
+    init_editor_history(simulation.history);
+    simulation.clock.store(0);
+    simulation.next_event_time.store(0);
+
+    simulation.snapshots.front = 0;
+    simulation.snapshots.back = 1;
+    simulation.snapshots.shared.store(2);
+
+    // Publish the empty map so the main thread has a snapshot to draw before the first step
+    publish_snapshot(simulation);
+    simulation.snapshots.acquire();
+}
+
+// Function to read how far the molds of a game have got
+mold_progress_data read_mold_progress(const game_data &game)
+{
+    mold_progress_data progress;
+    progress.molds = game.molds.v.size();
+    progress.spreads = 0;
+    progress.states = 0;
+    for (int i = 0; i < game.molds.v.size(); i++)
     {
-        stop_sound_effect("Drawing Sound");
+        progress.spreads += game.molds.v[i].spreads_count;
+        progress.states += game.molds.v[i].state;
     }
+    progress.broken_proportion = game.broken_proportion;
+    progress.border_proportion = game.border_proportion;
+    progress.state = game.state;
+    return progress;
 }
 
-// Function to handle general input for the explorer
-void handle_input(explorer_data &explorer, game_effect_data &game_effect)
+// Function to apply queued edits and advance the molds to the given game time (returns true if anything changed)
+bool step_simulation(simulation_data &simulation, long current_time)
 {
-    handle_editor_input(explorer, game_effect);
+    mold_progress_data before = read_mold_progress(simulation.game);
+    bool changed = false;
 
-    if (key_down(LEFT_KEY))
+    editor_command_data command;
+    while (simulation.commands.pop(command))
     {
-        explorer.camera.x -= 2;
+        changed = handle_editor_command(simulation, command) || changed;
     }
-    if (key_down(RIGHT_KEY))
+
+    spread_new_molds(simulation.map, simulation.game, current_time);
+
+    update_current_molds(simulation.game, simulation.map, simulation.threat, current_time);
+
+    update_game(simulation.game, simulation.map);
+
+    simulation.game.if_game_over(current_time);
+
+    return changed || !read_mold_progress(simulation.game).same_as(before);
+}
+
+// Function to check if edits are waiting for the simulation thread
+bool has_editor_commands(const simulation_data &simulation)
+{
+    return simulation.commands.head.load(memory_order_relaxed) != simulation.commands.tail.load(memory_order_acquire);
+}
+
+// Function to wake the simulation thread (taking the lock first, so a wake-up between its check and its wait is not lost)
+void wake_simulation(simulation_data &simulation)
+{
     {
-        explorer.camera.x += 2;
+        lock_guard<mutex> lock(simulation.wake_mutex);
     }
-    if (key_down(UP_KEY))
+    simulation.wake.notify_one();
+}
+
+// Function run by the simulation thread: step when an edit arrives or the game time reaches the next mold event, until stopped or the game is over
+void run_simulation(simulation_data &simulation)
+{
+    while (simulation.running.load(memory_order_acquire))
     {
-        explorer.camera.y -= 2;
+        long current_time = simulation.clock.load(memory_order_acquire);
+
+        // Only hand the main thread a new snapshot when something on the map or in the molds changed
+        if (step_simulation(simulation, current_time))
+        {
+            publish_snapshot(simulation);
+        }
+
+        if (simulation.game.state == GAME_OVER)
+        {
+            return;
+        }
+
+        long next_event_time = current_time + time_to_next_mold_event(simulation.game, current_time);
+        simulation.next_event_time.store(next_event_time, memory_order_release);
+
+        // Sleep until there is something to do (never stepping twice at the same game time without an edit)
+        unique_lock<mutex> lock(simulation.wake_mutex);
+        simulation.wake.wait(lock, [&]()
+                             {
+            long clock = simulation.clock.load(memory_order_acquire);
+            return !simulation.running.load(memory_order_acquire) || has_editor_commands(simulation) ||
+                   (clock > current_time && clock >= next_event_time); });
     }
-    if (key_down(DOWN_KEY))
+}
+
+// Function to start a new game on the simulation thread
+void start_simulation(simulation_data &simulation, const game_data &settings)
+{
+    init_simulation(simulation, settings);
+    init_threat_parallel(simulation.threat_parallel, min(THREAT_POOL_THREADS, max(1, static_cast<int>(thread::hardware_concurrency()))));
+    simulation.running.store(true);
+    simulation.worker = thread(run_simulation, ref(simulation));
+}
+
+// Function to stop the simulation thread and wait for it to finish
+void stop_simulation(simulation_data &simulation)
+{
+    simulation.running.store(false, memory_order_release);
+    wake_simulation(simulation);
+    if (simulation.worker.joinable())
     {
-        explorer.camera.y += 2;
+        simulation.worker.join();
+        flood_fill::stop_thread_pool(simulation.threat_parallel.pool);
     }
 }
 
 // Function to handle the prepare game state
-void handle_prepare_state(game_data &game, explorer_data &explorer)
+void handle_prepare_state(game_data &game, explorer_data &explorer, simulation_data &simulation)
 {
+    TRACK_ALLOCATIONS("handle_prepare_state");
+
     if (game.state == PREPARE_GAME)
     {
+        stop_simulation(simulation);
         init_explorer(explorer);
+
+        // The growth model is chosen on the menu, so it outlives the reset
+        spread_model model = game.model;
         game = init_game();
+        game.model = model;
     }
 }
 
-// Function to spread new molds
-void spread_new_molds(explorer_data &explorer, game_data &game)
+// Functio to handle the playing state
+void handle_playing_state(game_data &game, explorer_data &explorer, game_effect_data &game_effect, simulation_data &simulation, const snapshot_data &snapshot)
 {
-    // Check if there is space available for mold to spread
-    if (is_space_available(explorer.map))
+    TRACK_ALLOCATIONS("handle_playing_state");
+
+    if (game.state == PLAYING)
     {
-        // Check if it's time for the next mold to appear
-        if (game.molds.is_time_to_appear_next(timer_ticks(GAME_TIMER)))
+        // The molds of a new game are simulated on their own thread (its first snapshot is taken next frame)
+        if (!simulation.worker.joinable())
         {
+            start_simulation(simulation, game);
+            return;
+        }
 
-            // Select a random starting position for the new mold
-            int start_c, start_r;
-            do
-            {
-                start_c = rnd(0, MAX_MAP_COLS - 1);
-                start_r = rnd(0, MAX_MAP_ROWS - 1);
-            } while (explorer.map.tiles[start_c][start_r].kind != NORMAL_TILE);
+        handle_input(explorer, game_effect, snapshot, simulation.commands);
+
+        // Read the game clock once per frame and hand it to the simulation, waking it only when it has something to do
+        long current_time = timer_ticks(GAME_TIMER);
+        simulation.clock.store(current_time, memory_order_release);
+        if (has_editor_commands(simulation) || current_time >= simulation.next_event_time.load(memory_order_acquire))
+        {
+            wake_simulation(simulation);
+        }
 
-            mold_data new_mold = init_mold(start_c, start_r); // Initialize new mold
-            game.molds.v.push_back(new_mold);                 // Add new mold to the vector
+        game.broken_proportion = snapshot.broken_proportion;
+        game.border_proportion = snapshot.border_proportion;
 
-            game.molds.time_to_appear_next = timer_ticks(GAME_TIMER) + game.mold_appearance_time + rnd(0, 2000); // Set time for next mold appearance
+        if (snapshot.is_game_over)
+        {
+            game.score = snapshot.score;
+            game.state = GAME_OVER;
         }
     }
 }
 
-// Function to update current molds
-void update_current_molds(game_data &game, explorer_data &explorer)
+// Function to initialize the frame pacer
+frame_pacer_data init_frame_pacer(int target_fps, int idle_fps)
 {
-    if (!game.molds.v.empty())
+    frame_pacer_data pacer;
+    pacer.target_fps = target_fps;
+    pacer.idle_fps = idle_fps;
+    pacer.next_frame_at = steady_clock::now();
+    return pacer;
+}
+
+// Function to check if the player is doing anything that needs a smooth frame rate
+bool is_input_active()
+{
+    vector_2d movement = mouse_movement();
+    return any_key_pressed() || mouse_down(LEFT_BUTTON) || movement.x != 0 || movement.y != 0;
+}
+
+// Function to work out how long the next frame should last (in microseconds)
+long frame_interval(const frame_pacer_data &pacer, const game_data &game, long next_event_time)
+{
+    long active_interval = 1000000 / pacer.target_fps;
+    long idle_interval = 1000000 / pacer.idle_fps;
+
+    if (is_input_active())
     {
-        for (int i = 0; i < game.molds.v.size(); i++)
-        {
-            // Handle mold lifecycle
-            handle_mold_lifecycle(explorer.map, game.molds.v[i]);
+        return active_interval;
+    }
 
-            // Remove finished molds
-            if (game.molds.v[i].state == BROKEN)
-            {
-                game.molds.v.erase(game.molds.v.begin() + i);
-                i--;
-            }
-        }
+    // While idle in a game, wake up for the next mold event rather than waiting out a whole idle frame
+    if (game.state == PLAYING)
+    {
+        long until_event = max(0L, next_event_time - timer_ticks(GAME_TIMER)) * 1000;
+        return max(active_interval, min(idle_interval, until_event));
     }
+
+    return idle_interval;
 }
 
-// Functio to handle the playing state
-void handle_playing_state(game_data &game, explorer_data &explorer, game_effect_data &game_effect)
+// Function to wait until the next frame is due (sleep for most of the wait, then spin for accuracy)
+void wait_for_next_frame(frame_pacer_data &pacer, long interval_us)
 {
-    if (game.state == PLAYING)
+    steady_clock::time_point deadline = pacer.next_frame_at + microseconds(interval_us);
+    steady_clock::time_point now = steady_clock::now();
+
+    // Start a fresh schedule if the last frame ran late, instead of rushing to catch up
+    if (deadline < now)
+    {
+        pacer.next_frame_at = now;
+        return;
+    }
+
+    if (deadline - now > microseconds(FRAME_SPIN_MARGIN_US))
+    {
+        this_thread::sleep_until(deadline - microseconds(FRAME_SPIN_MARGIN_US));
+    }
+    while (steady_clock::now() < deadline)
     {
-        handle_input(explorer, game_effect);
+    }
 
-        game.if_game_over();
+    pacer.next_frame_at = deadline;
+}
+
+// Function to draw the map of a scripted game to the software framebuffer, for benchmarking and comparing frames without a display
+void run_headless(int frames, const string &output_prefix)
+{
+    renderer_data renderer;
+    init_renderer(renderer, SOFTWARE_BACKEND, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    explorer_data explorer;
+    init_explorer(explorer);
+    explorer.show_threat = true;
+    set_zoom_level(explorer, DEFAULT_ZOOM_LEVEL + 1); // Show the whole map
+
+    // Start molds at fixed places so every run draws the same frames
+    vector<mold_data> molds;
+    molds.push_back(init_mold(5, 5, 1, 0));
+    molds.push_back(init_mold(30, 10, 2, 0));
+    molds.push_back(init_mold(20, 32, 3, 0));
 
-        spread_new_molds(explorer, game);
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        // Spread every mold one step per frame instead of waiting for the game timer
+        for (int i = 0; i < molds.size(); i++)
+        {
+            if (molds[i].state == SPREADING)
+            {
+                spread_mold(explorer.map, molds[i], explorer.threat, 0);
+            }
+            else
+            {
+                handle_mold_lifecycle(explorer.map, molds[i], explorer.threat, 0);
+            }
+        }
 
-        update_current_molds(game, explorer);
+        render_set_camera(renderer, explorer.camera);
+        render_clear(renderer, color_white());
+        draw_map(renderer, explorer.map, explorer.camera, explorer.tile_size);
+        draw_threat_overlay(renderer, explorer.threat, explorer.camera, explorer.tile_size);
 
-        update_game(game, explorer.map);
+        if (!output_prefix.empty())
+        {
+            write_frame_ppm(renderer, output_prefix + to_string(frame) + ".ppm");
+        }
     }
+
+    double elapsed_ms = duration<double, milli>(steady_clock::now() - start).count();
+    write_line("Rendered " + to_string(frames) + " frames in " + to_string(elapsed_ms) + " ms (" + to_string(elapsed_ms / max(frames, 1)) + " ms per frame, " + to_string(renderer.fill_count / max(frames, 1)) + " rectangles per frame)");
 }
 
-// Main function to run the game
-int main()
+#ifndef MOLDBOUND_NO_MAIN
+// Main function to run the game (pass --headless <frames> [output prefix] to render without a window)
+int main(int argc, char *argv[])
 {
-    play_music("Game Music");
+    if (argc >= 3 && string(argv[1]) == "--headless")
+    {
+        run_headless(stoi(argv[2]), argc >= 4 ? argv[3] : "");
+        return 0;
+    }
+
+    play_music(GAME_MUSIC);
     set_music_volume(MUSIC_VOLUME);
 
     explorer_data explorer;
+    simulation_data simulation;
     game_data game = init_game();
     game_effect_data game_effect = init_game_effect();
+    score_store_data score_store;
+    init_score_store(score_store);
+    frame_pacer_data pacer = init_frame_pacer(TARGET_FPS, IDLE_FPS);
+    frame_invalidation_data invalidation = init_frame_invalidation();
 
     set_interface_accent_color(color_dark_olive_green(), 1.0);
-    set_interface_font("Text Font");
+    set_interface_font(TEXT_FONT);
 
     open_window("Moldbound", WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    create_timer(GAME_TIMER);
+    renderer_data renderer;
+    init_renderer(renderer, SPLASHKIT_BACKEND, WINDOW_WIDTH, WINDOW_HEIGHT);
+
 
     while (!quit_requested())
     {
         process_events();
 
+#ifdef MOLDBOUND_ALLOC_TRACKING
+        // F3 shows or hides the allocation overlay
+        if (key_typed(F3_KEY))
+        {
+            alloc_tracker.show_overlay = !alloc_tracker.show_overlay;
+        }
+#endif
+
         // Play background music
         if (!music_playing() && game_effect.is_sound_on)
         {
-            play_music("Game Music");
+            play_music(GAME_MUSIC);
         }
 
-        draw_explorer(explorer, game, game_effect);
+        // Take the newest snapshot once per frame; it stays the main thread's until the next frame takes another
+        const snapshot_data &snapshot = simulation.snapshots.acquire();
 
-        handle_prepare_state(game, explorer);
+        // Only draw when something on screen would change
+        if (frame_needs_redraw(invalidation, record_frame(explorer, snapshot, game, game_effect)))
+        {
+            draw_explorer(renderer, explorer, snapshot, game, game_effect, score_store);
+        }
 
-        handle_playing_state(game, explorer, game_effect);
+        handle_prepare_state(game, explorer, simulation);
+
+        handle_playing_state(game, explorer, game_effect, simulation, snapshot);
 
         // Handle the quit game state
         if (game.state == QUIT)
         {
-            return 0;
+            break;
         }
+
+#ifdef MOLDBOUND_ALLOC_TRACKING
+        end_alloc_frame();
+#endif
+
+        wait_for_next_frame(pacer, frame_interval(pacer, game, simulation.next_event_time.load(memory_order_acquire)));
     }
 
+    stop_simulation(simulation);
+
+#ifdef MOLDBOUND_ALLOC_TRACKING
+    write_alloc_report(ALLOC_REPORT_FILE);
+#endif
+
     // Free resources
     free_all_music();
     free_all_sound_effects();
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,480 @@
+// Microbenchmarks for the simulation and flood fill hot paths.
+// CMakeLists.txt builds one executable per map size (MOLDBOUND_MAP_SIZE / FLOODFILL_GRID_SIZE);
+// each one prints a JSON report to stdout, or to the file given as its first argument.
+#include "splashkit.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdlib>
+#include <new>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "../MoldGame.cpp"
+#include "../FloodFill.h"
+
+// Constants for the benchmarks
+const double MIN_BENCH_TIME_NS = 2e8;     // Keep measuring a benchmark until this much time was timed
+const long MIN_BENCH_OPS = 3;             // Measure at least this many operations
+const long MAX_BENCH_OPS = 1000000;       // Stop after this many operations
+const int DFS_MAX_CELLS = 4096;           // Larger grids can overflow a 1 MB stack (the Windows default) in the recursive fill
+const int LIFECYCLE_BOX_SIZE = 64;        // Side of the walled area a mold lives in for the lifecycle benchmark
+const int SCORE_BENCH_RECORDS = 100000;   // Number of scores in the log for the score benchmark
+
+// Number of allocations made so far (counted by the operator new below)
+long allocation_count = 0;
+
+// Pointer the compiler has to assume is read elsewhere, so benchmarked work is never optimised away
+const void *volatile escape_sink = nullptr;
+
+// Function to make a value look used to the optimiser
+void do_not_optimize(const void *p)
+{
+    escape_sink = p;
+}
+
+void *operator new(size_t size)
+{
+    allocation_count++;
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// Structure to represent the measurements for one benchmark
+struct benchmark_data
+{
+    string name;      // Name of the benchmark
+    long ops;         // Number of timed operations
+    long tiles;       // Number of tiles the timed operations worked on
+    double total_ns;  // Total timed nanoseconds
+    long allocations; // Allocations made during the timed operations
+    string skipped;   // Reason the benchmark was skipped (empty if it ran)
+};
+
+// Function to initialize a benchmark
+benchmark_data init_benchmark(const string &name)
+{
+    benchmark_data bench;
+    bench.name = name;
+    bench.ops = 0;
+    bench.tiles = 0;
+    bench.total_ns = 0;
+    bench.allocations = 0;
+    return bench;
+}
+
+// Function to check if a benchmark should keep measuring
+bool needs_more_ops(const benchmark_data &bench)
+{
+    return bench.ops < MIN_BENCH_OPS || (bench.total_ns < MIN_BENCH_TIME_NS && bench.ops < MAX_BENCH_OPS);
+}
+
+// Function to time one operation
+template <typename F>
+void time_op(benchmark_data &bench, F op)
+{
+    long allocations_before = allocation_count;
+    steady_clock::time_point start = steady_clock::now();
+
+    op();
+
+    bench.total_ns += duration<double, nano>(steady_clock::now() - start).count();
+    bench.allocations += allocation_count - allocations_before;
+    bench.ops++;
+}
+
+// Function to reset a mold in place, so its frontier keeps the capacity it grew to in earlier runs
+void reset_mold(mold_data *mold, int start_c, int start_r)
+{
+    init_mold_in_place(*mold, start_c, start_r, 1, 0);
+}
+
+// Function to fill a flood fill grid with one value
+void fill_grid(int grid[flood_fill::ROWS][flood_fill::COLUMNS], int value)
+{
+    for (int i = 0; i < flood_fill::ROWS; i++)
+    {
+        for (int j = 0; j < flood_fill::COLUMNS; j++)
+        {
+            grid[i][j] = value;
+        }
+    }
+}
+
+// Function to benchmark the recursive flood fill over a full grid
+benchmark_data bench_flood_fill_dfs()
+{
+    benchmark_data bench = init_benchmark("flood_fill_dfs");
+    if (flood_fill::ROWS * flood_fill::COLUMNS > DFS_MAX_CELLS)
+    {
+        bench.skipped = "recursion depth would overflow the stack";
+        return bench;
+    }
+
+    int(*grid)[flood_fill::COLUMNS] = new int[flood_fill::ROWS][flood_fill::COLUMNS];
+    while (needs_more_ops(bench))
+    {
+        fill_grid(grid, 1);
+        time_op(bench, [&]()
+                {
+            flood_fill::flood_fill_dfs(grid, 0, 0, 1, 2);
+            do_not_optimize(grid); });
+        bench.tiles += flood_fill::ROWS * flood_fill::COLUMNS;
+    }
+    delete[] grid;
+    return bench;
+}
+
+// Function to benchmark the iterative flood fill over a full grid
+benchmark_data bench_flood_fill_bfs()
+{
+    benchmark_data bench = init_benchmark("flood_fill_bfs");
+
+    int(*grid)[flood_fill::COLUMNS] = new int[flood_fill::ROWS][flood_fill::COLUMNS];
+    while (needs_more_ops(bench))
+    {
+        fill_grid(grid, 1);
+        time_op(bench, [&]()
+                {
+            flood_fill::flood_fill_bfs(grid, 0, 0, 1, 2);
+            do_not_optimize(grid); });
+        bench.tiles += flood_fill::ROWS * flood_fill::COLUMNS;
+    }
+    delete[] grid;
+    return bench;
+}
+
+// Function to benchmark the iterative flood fill while recording a step trace
+benchmark_data bench_flood_fill_bfs_traced()
+{
+    benchmark_data bench = init_benchmark("flood_fill_bfs_traced");
+
+    int(*grid)[flood_fill::COLUMNS] = new int[flood_fill::ROWS][flood_fill::COLUMNS];
+    flood_fill::step_trace_data trace;
+    while (needs_more_ops(bench))
+    {
+        fill_grid(grid, 1);
+        flood_fill::init_trace(trace, grid, 2);
+        time_op(bench, [&]()
+                {
+            flood_fill::flood_fill_bfs(grid, 0, 0, 1, 2, &trace);
+            do_not_optimize(grid); });
+        bench.tiles += flood_fill::ROWS * flood_fill::COLUMNS;
+    }
+    delete[] grid;
+    return bench;
+}
+
+// Function to benchmark the frontier-parallel flood fill on every hardware thread
+benchmark_data bench_flood_fill_parallel()
+{
+    benchmark_data bench = init_benchmark("flood_fill_parallel");
+
+    int(*grid)[flood_fill::COLUMNS] = new int[flood_fill::ROWS][flood_fill::COLUMNS];
+    flood_fill::thread_pool_data pool;
+    flood_fill::init_thread_pool(pool, max(1, static_cast<int>(thread::hardware_concurrency())));
+    while (needs_more_ops(bench))
+    {
+        fill_grid(grid, 1);
+        time_op(bench, [&]()
+                {
+            flood_fill::flood_fill_parallel(grid, 0, 0, 1, 2, pool);
+            do_not_optimize(grid); });
+        bench.tiles += flood_fill::ROWS * flood_fill::COLUMNS;
+    }
+    flood_fill::stop_thread_pool(pool);
+    delete[] grid;
+    return bench;
+}
+
+// Function to benchmark single spread steps of a mold growing from the middle of an open map
+benchmark_data bench_spread_mold(explorer_data *explorer, mold_data *mold)
+{
+    benchmark_data bench = init_benchmark("spread_mold");
+
+    while (needs_more_ops(bench))
+    {
+        // Start a fresh mold when the last one has filled the map
+        if (bench.ops == 0 || mold->q.empty())
+        {
+            init_explorer(*explorer);
+            reset_mold(mold, MAX_MAP_COLS / 2, MAX_MAP_ROWS / 2);
+            handle_mold_lifecycle(explorer->map, *mold, explorer->threat, 0);
+        }
+
+        int spreads_before = mold->spreads_count;
+        time_op(bench, [&]()
+                { spread_mold(explorer->map, *mold, explorer->threat, 0); });
+        bench.tiles += mold->spreads_count - spreads_before;
+    }
+    return bench;
+}
+
+// Function to benchmark ticks of the stochastic spread model for a mold growing from the middle of an open map
+benchmark_data bench_spread_molds_stochastic(explorer_data *explorer)
+{
+    benchmark_data bench = init_benchmark("spread_molds_stochastic");
+    game_data game = init_game();
+    long tick = 0;
+
+    while (needs_more_ops(bench))
+    {
+        // Start a fresh mold when the last one has stopped spreading
+        if (bench.ops == 0 || game.molds.v[0].state != SPREADING)
+        {
+            init_explorer(*explorer);
+            game.molds.v.resize(1); // Reuse the last mold, so its frontier keeps its capacity
+            init_mold_in_place(game.molds.v[0], MAX_MAP_COLS / 2, MAX_MAP_ROWS / 2, 1, 0);
+            game.molds.v[0].model = STOCHASTIC_SPREAD;
+            init_stochastic_spread(game.stochastic, 1, MEDIUM);
+            handle_mold_lifecycle(explorer->map, game.molds.v[0], explorer->threat, 0);
+            tick = 0;
+        }
+
+        long swept = 0;
+        tick++;
+        time_op(bench, [&]()
+                { swept = spread_molds_stochastic(explorer->map, game.molds, explorer->threat, game.stochastic, tick * MOLD_SPREAD_TIME); });
+        bench.tiles += swept;
+    }
+    return bench;
+}
+
+// Function to benchmark a whole mold lifecycle (appear, spread, fix, break) inside a walled box
+benchmark_data bench_handle_mold_lifecycle(explorer_data *explorer, mold_data *mold)
+{
+    benchmark_data bench = init_benchmark("handle_mold_lifecycle");
+    int box = min(LIFECYCLE_BOX_SIZE, min(MAX_MAP_COLS, MAX_MAP_ROWS));
+
+    while (needs_more_ops(bench))
+    {
+        init_explorer(*explorer);
+        for (int i = 0; i <= box; i++)
+        {
+            if (box < MAX_MAP_COLS)
+                set_tile_kind(explorer->map, box, i, BORDER_TILE);
+            if (box < MAX_MAP_ROWS)
+                set_tile_kind(explorer->map, i, box, BORDER_TILE);
+        }
+        reset_mold(mold, box / 2, box / 2);
+
+        time_op(bench, [&]()
+                {
+            while (mold->state != BROKEN)
+            {
+                // The clock stays at 0 here, so make every timed step due straight away
+                mold->last_spread_time = -MOLD_SPREAD_TIME;
+                mold->time_to_start_fix = -1;
+                handle_mold_lifecycle(explorer->map, *mold, explorer->threat, 0);
+            } });
+        bench.tiles += mold->spreads_count;
+    }
+    return bench;
+}
+
+// Function to benchmark counting broken and border tiles
+benchmark_data bench_update_game(explorer_data *explorer)
+{
+    benchmark_data bench = init_benchmark("update_game");
+    game_data game = init_game();
+
+    init_explorer(*explorer);
+    for (int i = 0; i < MAX_MAP_COLS; i++)
+    {
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            set_tile_kind(explorer->map, i, j, static_cast<tile_kind>((i * 7 + j * 3) % 5));
+        }
+    }
+
+    while (needs_more_ops(bench))
+    {
+        time_op(bench, [&]()
+                {
+            update_game(game, explorer->map);
+            do_not_optimize(&game); });
+        bench.tiles += MAX_MAP_COLS * MAX_MAP_ROWS;
+    }
+    return bench;
+}
+
+// Function to benchmark the worst case of the free space check (only the last tile is free)
+benchmark_data bench_is_space_available(explorer_data *explorer)
+{
+    benchmark_data bench = init_benchmark("is_space_available");
+
+    init_explorer(*explorer);
+    for (int i = 0; i < MAX_MAP_COLS; i++)
+    {
+        for (int j = 0; j < MAX_MAP_ROWS; j++)
+        {
+            set_tile_kind(explorer->map, i, j, BROKEN_TILE);
+        }
+    }
+    set_tile_kind(explorer->map, MAX_MAP_COLS - 1, MAX_MAP_ROWS - 1, NORMAL_TILE);
+
+    bool available = false;
+    while (needs_more_ops(bench))
+    {
+        time_op(bench, [&]()
+                {
+            available = is_space_available(explorer->map);
+            do_not_optimize(&available); });
+        bench.tiles += MAX_MAP_COLS * MAX_MAP_ROWS;
+    }
+    if (!available)
+    {
+        bench.skipped = "free tile was not found";
+    }
+    return bench;
+}
+
+// Function to benchmark closing the frontier tile in the middle of an open map, whose reset region is refilled from a frontier on the left edge
+// With a thread pool given, regions of at least THREAT_PARALLEL_MIN_REGION tiles are relaxed on it
+benchmark_data bench_close_threat_tile(explorer_data *explorer, const string &name, threat_parallel_data *parallel)
+{
+    benchmark_data bench = init_benchmark(name);
+    int mid_c = MAX_MAP_COLS / 2;
+    int mid_r = MAX_MAP_ROWS / 2;
+
+    init_explorer(*explorer);
+    explorer->threat.parallel = parallel;
+    set_tile_kind(explorer->map, 0, mid_r, MOLDY_TILE);
+    add_threat_source(explorer->map, explorer->threat, 0, mid_r);
+
+    while (needs_more_ops(bench))
+    {
+        set_tile_kind(explorer->map, mid_c, mid_r, MOLDY_TILE);
+        add_threat_source(explorer->map, explorer->threat, mid_c, mid_r);
+        set_tile_kind(explorer->map, mid_c, mid_r, FIX_TILE);
+
+        time_op(bench, [&]()
+                { close_threat_tile(explorer->map, explorer->threat, mid_c, mid_r); });
+        bench.tiles += MAX_MAP_COLS * MAX_MAP_ROWS;
+    }
+    explorer->threat.parallel = nullptr;
+    return bench;
+}
+
+// Function to benchmark the menu's leaderboard query over a large score log (run in a temporary directory)
+benchmark_data bench_get_top_5_scores()
+{
+    benchmark_data bench = init_benchmark("get_top_5_scores");
+
+    filesystem::path old_dir = filesystem::current_path();
+    filesystem::path bench_dir = filesystem::temp_directory_path() / "moldbound-bench";
+    filesystem::remove_all(bench_dir);
+    filesystem::create_directories(bench_dir);
+    filesystem::current_path(bench_dir);
+
+    ofstream log_file(SCORE_FILE, ios::binary);
+    for (int i = 0; i < SCORE_BENCH_RECORDS; i++)
+    {
+        score_record record;
+        record.score = (i * 7919) % 5000;
+        record.difficulty = i % 3;
+        record.timestamp = i;
+        log_file.write(reinterpret_cast<const char *>(&record), sizeof(score_record));
+    }
+    log_file.close();
+
+    score_store_data store;
+    init_score_store(store);
+
+    vector<int> top_scores;
+    while (needs_more_ops(bench))
+    {
+        time_op(bench, [&]()
+                {
+            refresh_score_store(store);
+            top_scores = get_top_5_scores(store); });
+    }
+
+    filesystem::current_path(old_dir);
+    filesystem::remove_all(bench_dir);
+    return bench;
+}
+
+// Function to write the results as JSON
+void write_json(ostream &out, const vector<benchmark_data> &results)
+{
+    out << "{\n  \"map_size\": " << MAX_MAP_COLS << ",\n  \"benchmarks\": [\n";
+    for (int i = 0; i < results.size(); i++)
+    {
+        const benchmark_data &bench = results[i];
+        out << "    {\"name\": \"" << bench.name << "\"";
+        if (!bench.skipped.empty())
+        {
+            out << ", \"skipped\": \"" << bench.skipped << "\"}";
+        }
+        else
+        {
+            out << ", \"ops\": " << bench.ops
+                << ", \"ns_per_op\": " << bench.total_ns / bench.ops;
+            if (bench.tiles > 0)
+                out << ", \"ns_per_tile\": " << bench.total_ns / bench.tiles;
+            else
+                out << ", \"ns_per_tile\": null";
+            out << ", \"allocations_per_op\": " << static_cast<double>(bench.allocations) / bench.ops << "}";
+        }
+        out << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    // Maps are far too big for the stack on the larger sizes
+    explorer_data *explorer = new explorer_data;
+    mold_data *mold = new mold_data(init_mold(0, 0, 1, 0));
+    do_not_optimize(explorer);
+
+    vector<benchmark_data> results;
+    results.push_back(bench_flood_fill_dfs());
+    results.push_back(bench_flood_fill_bfs());
+    results.push_back(bench_flood_fill_bfs_traced());
+    results.push_back(bench_flood_fill_parallel());
+    results.push_back(bench_spread_mold(explorer, mold));
+    results.push_back(bench_handle_mold_lifecycle(explorer, mold));
+    results.push_back(bench_spread_molds_stochastic(explorer));
+    results.push_back(bench_update_game(explorer));
+    results.push_back(bench_is_space_available(explorer));
+    results.push_back(bench_close_threat_tile(explorer, "close_threat_tile", nullptr));
+
+    threat_parallel_data *parallel = new threat_parallel_data;
+    init_threat_parallel(*parallel, max(1, static_cast<int>(thread::hardware_concurrency())));
+    results.push_back(bench_close_threat_tile(explorer, "close_threat_tile_parallel", parallel));
+    flood_fill::stop_thread_pool(parallel->pool);
+    delete parallel;
+    results.push_back(bench_get_top_5_scores());
+
+    delete mold;
+    delete explorer;
+
+    if (argc >= 2)
+    {
+        ofstream json_file(argv[1]);
+        write_json(json_file, results);
+    }
+    else
+    {
+        write_json(cout, results);
+    }
+
+    return 0;
+}
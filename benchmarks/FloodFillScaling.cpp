@@ -0,0 +1,113 @@
+// Scaling report for the parallel flood fill.
+// CMakeLists.txt builds this at FLOODFILL_SCALING_SIZE (10000 x 10000 by default). It times the serial BFS once,
+// then the parallel fill on 1, 2, 4, ... threads up to the given maximum (default: every hardware thread), checks each
+// result against the serial one and prints a JSON report to stdout, or to the file given as the second argument.
+// Usage: flood_fill_scaling [max threads] [output file]
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "../FloodFill.h"
+
+using namespace std;
+using namespace flood_fill;
+using namespace std::chrono;
+
+// Structure to represent the measurement for one thread count
+struct scaling_result_data
+{
+    int threads;     // Number of threads (0 for the serial BFS)
+    double ms;       // Time the fill took
+    bool is_correct; // Whether the result matched the serial fill
+};
+
+// Function to set up the grid: all cells fillable except walls with gaps, so the fill has to wind around them
+void init_scaling_grid(int grid[ROWS][COLUMNS])
+{
+    for (int i = 0; i < ROWS; i++)
+    {
+        for (int j = 0; j < COLUMNS; j++)
+        {
+            bool is_wall = i % 100 == 50 && j % 1000 != 0;
+            grid[i][j] = is_wall ? 0 : 1;
+        }
+    }
+}
+
+// Function to write the results as JSON
+void write_scaling_json(ostream &out, const vector<scaling_result_data> &results)
+{
+    double serial_ms = results[0].ms;
+    out << "{\n  \"grid_size\": " << ROWS << ",\n  \"serial_bfs_ms\": " << serial_ms << ",\n  \"parallel\": [\n";
+    for (size_t i = 1; i < results.size(); i++)
+    {
+        out << "    {\"threads\": " << results[i].threads
+            << ", \"ms\": " << results[i].ms
+            << ", \"speedup_vs_serial\": " << serial_ms / results[i].ms
+            << ", \"speedup_vs_1_thread\": " << results[1].ms / results[i].ms
+            << ", \"matches_serial\": " << (results[i].is_correct ? "true" : "false") << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+    int max_threads = argc >= 2 ? stoi(argv[1]) : static_cast<int>(thread::hardware_concurrency());
+    max_threads = max(max_threads, 1);
+
+    // The grids are far too big for the stack
+    int(*expected)[COLUMNS] = new int[ROWS][COLUMNS];
+    int(*grid)[COLUMNS] = new int[ROWS][COLUMNS];
+    vector<scaling_result_data> results;
+
+    init_scaling_grid(expected);
+    steady_clock::time_point start = steady_clock::now();
+    flood_fill_bfs(expected, 0, 0, 1, 2);
+    results.push_back({0, duration<double, milli>(steady_clock::now() - start).count(), true});
+
+    vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (size_t i = 0; i < thread_counts.size(); i++)
+    {
+        thread_pool_data pool;
+        init_thread_pool(pool, thread_counts[i]);
+        init_scaling_grid(grid);
+
+        start = steady_clock::now();
+        flood_fill_parallel(grid, 0, 0, 1, 2, pool);
+        double ms = duration<double, milli>(steady_clock::now() - start).count();
+        stop_thread_pool(pool);
+
+        bool is_correct = equal(&grid[0][0], &grid[0][0] + static_cast<size_t>(ROWS) * COLUMNS, &expected[0][0]);
+        results.push_back({thread_counts[i], ms, is_correct});
+    }
+
+    delete[] grid;
+    delete[] expected;
+
+    if (argc >= 3)
+    {
+        ofstream json_file(argv[2]);
+        write_scaling_json(json_file, results);
+    }
+    else
+    {
+        write_scaling_json(cout, results);
+    }
+
+    for (size_t i = 1; i < results.size(); i++)
+    {
+        if (!results[i].is_correct)
+            return 1;
+    }
+    return 0;
+}
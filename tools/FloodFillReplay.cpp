@@ -0,0 +1,108 @@
+// Replays a flood fill trace recorded by flood_fill.
+// Usage: flood_fill_replay <trace file> [--frames | --animate [ms per step] | --final]
+//   --frames   print the grid after every step (the default)
+//   --animate  redraw the grid in place, one step at a time
+//   --final    print only the filled grid and the number of steps
+#include <iostream>
+#include <chrono>
+#include <thread>
+
+#include "../FloodFill.h"
+
+using namespace std;
+using namespace flood_fill;
+
+// Enum for the ways a trace can be replayed
+enum replay_mode
+{
+    REPLAY_FRAMES,
+    REPLAY_ANIMATE,
+    REPLAY_FINAL
+};
+
+// Function to print the grid as one block of text (written in one go, without flushing per cell)
+void print_frame(const vector<int> &grid, int rows, int columns, const string &title)
+{
+    string frame = title + "\n";
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < columns; j++)
+        {
+            frame += to_string(grid[i * columns + j]) + " ";
+        }
+        frame += "\n";
+    }
+    cout << frame << "\n";
+}
+
+// Function to replay a trace, applying its steps to the starting grid in order (read_trace has checked every step; steps are shown numbered from 1)
+void replay_trace(const step_trace_data &trace, replay_mode mode, int step_delay_ms)
+{
+    vector<int> grid = trace.initial;
+
+    for (uint32_t i = 0; i < trace.count; i++)
+    {
+        const trace_step_data &step = trace.steps[i];
+        grid[step.x * trace.columns + step.y] = trace.replacement;
+
+        switch (mode)
+        {
+        case REPLAY_FRAMES:
+            print_frame(grid, trace.rows, trace.columns, "Step " + to_string(step.step + 1) + ": (" + to_string(step.x) + ", " + to_string(step.y) + ")");
+            break;
+        case REPLAY_ANIMATE:
+            cout << "\033[H\033[2J"; // Clear the terminal and move to its top-left corner
+            print_frame(grid, trace.rows, trace.columns, "Step " + to_string(step.step + 1) + " of " + to_string(trace.count));
+            cout.flush();
+            this_thread::sleep_for(chrono::milliseconds(step_delay_ms));
+            break;
+        case REPLAY_FINAL:
+            break;
+        }
+    }
+
+    if (mode == REPLAY_FINAL)
+    {
+        print_frame(grid, trace.rows, trace.columns, to_string(trace.count) + " steps");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: flood_fill_replay <trace file> [--frames | --animate [ms per step] | --final]\n";
+        return 1;
+    }
+
+    replay_mode mode = REPLAY_FRAMES;
+    int step_delay_ms = 100;
+    if (argc >= 3)
+    {
+        string option = argv[2];
+        if (option == "--animate")
+        {
+            mode = REPLAY_ANIMATE;
+            if (argc >= 4)
+                step_delay_ms = stoi(argv[3]);
+        }
+        else if (option == "--final")
+        {
+            mode = REPLAY_FINAL;
+        }
+        else if (option != "--frames")
+        {
+            cout << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+
+    step_trace_data trace;
+    if (!read_trace(trace, argv[1]))
+    {
+        return 1;
+    }
+
+    replay_trace(trace, mode, step_delay_ms);
+    return 0;
+}